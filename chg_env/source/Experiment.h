@@ -9,6 +9,14 @@
 #include <sys/stat.h>
 #include <algorithm>
 #include <functional>
+#include <array>
+#include <thread>
+#include <limits>
+#include <unordered_set>
+#include <chrono>
+#include <unordered_map>
+#include <cstring>
+#include <memory>
 
 #include "base/Ptr.h"
 #include "base/vector.h"
@@ -27,6 +35,13 @@
 
 #include "l9_chg_env-config.h"
 #include "TaskSet.h"
+#include "LogicTasks.h"
+#include "LockstepHardware.h"
+#include "TagBindings.h"
+#include "FunctionUsage.h"
+#include "PackedProgram.h"
+#include "PackedMutator.h"
+#include "MapArchive.h"
 
 constexpr size_t TAG_WIDTH = 16;
 
@@ -52,11 +67,60 @@ constexpr size_t ENV_CHG_METHOD_ID__SHUFFLED = 1;
 constexpr size_t ENV_CHG_METHOD_ID__REGULAR = 2;
 
 constexpr size_t TRAIT_ID__STATE = 0;
+constexpr size_t TRAIT_ID__EVAL_CTX = 1;
 
 constexpr size_t SELECTION_METHOD_ID__TOURNAMENT = 0;
 
+constexpr size_t EVAL_RNG_MODE_ID__SHARED = 0;
+constexpr size_t EVAL_RNG_MODE_ID__TRIAL_STREAMS = 1;
+
+constexpr size_t MUT_SAMPLING_MODE_ID__PER_SITE = 0;
+constexpr size_t MUT_SAMPLING_MODE_ID__GEOMETRIC = 1;
+
+constexpr size_t REPRODUCTION_CHUNK_SIZE = 64;  ///< Offspring per random number stream in parallel reproduction.
+constexpr size_t SNAPSHOT_TRIAL_CHUNK_SIZE = 10; ///< Snapshot trials per work item (see EvaluateSnapshots).
+
+#ifdef EMP_TRACK_MEM
+/// emp::Ptr's memory tracker is an unsynchronized global: with it on, every worker runs on the main thread, in order.
+constexpr bool WORKER_THREADS = false;
+#else
+constexpr bool WORKER_THREADS = true;
+#endif
+
+constexpr size_t ANALYSIS_METHOD_ID__EVAL_BENCHMARK = 0;
+constexpr size_t ANALYSIS_METHOD_ID__DISPATCH_BENCHMARK = 1;
+constexpr size_t ANALYSIS_METHOD_ID__LOCKSTEP_EQUIVALENCE = 2;
+constexpr size_t ANALYSIS_METHOD_ID__HARDWARE_TRAJECTORY = 3;
+
+/// Most environment signals a single timestep can send: a shuffled change, a regular-interval change, and a
+/// distraction (see GenerateEnvSchedule).
+constexpr size_t MAX_ENV_SIGNALS_PER_STEP = 3;
+
+constexpr size_t LOCKSTEP_MEM_SIZE = 16; ///< Registers per memory on lockstep hardware (instruction arguments must be smaller).
+constexpr size_t MAX_FUNC_CNT = 128;      ///< Maximum number of functions per program (width of function usage bitsets).
+
 constexpr double MIN_POSSIBLE_SCORE = -32767;
 
+/// Counter-based mixing function (SplitMix64 finalizer).
+/// Consecutive inputs map to statistically unrelated outputs.
+inline uint64_t MixStreamKey(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+/// Derive the random seed of an independent random number stream from (seed, update, agent, trial).
+/// The result only depends on the key, never on how many numbers were drawn before.
+inline int GetStreamSeed(uint64_t seed, uint64_t update, uint64_t agent, uint64_t trial) {
+  uint64_t key = MixStreamKey(seed);
+  key = MixStreamKey(key ^ update);
+  key = MixStreamKey(key ^ agent);
+  key = MixStreamKey(key ^ trial);
+  // emp::Random seeds itself from the clock when given a non-positive seed; stay in [1, INT_MAX].
+  return (int)(key % (uint64_t)std::numeric_limits<int>::max()) + 1;
+}
+
 class Experiment {
 public:
   // Forward declarations.
@@ -64,6 +128,9 @@ public:
   struct Genome;
   struct Phenotype;
   class PhenotypeCache;
+  struct EnvSchedule;
+  struct EvalContext;
+  struct MutationContext;
 
   // Type aliases
   // - Hardware aliases
@@ -83,18 +150,74 @@ public:
   using phenotype_t = Phenotype;
   using phen_cache_t = PhenotypeCache;
   using genome_t = Genome;
+  using eval_ctx_t = EvalContext;
+  using mut_ctx_t = MutationContext;
+  using env_schedule_t = EnvSchedule;
+  using packed_program_t = PackedProgram;
+  using packed_arena_t = PackedProgramArena;
   // - World aliases
   using world_t = emp::World<agent_t>;
   using task_io_t = uint32_t;
   using taskset_t = TaskSet<std::array<task_io_t, MAX_TASK_NUM_INPUTS>, task_io_t>;
+  using task_solutions_t = std::array<task_io_t, LOGIC_TASK_SOLUTION_CNT>;
+  // - Lockstep hardware aliases
+  using batch_hw_t = LockstepHardware<taskset_t, TAG_WIDTH, LOCKSTEP_MEM_SIZE, MAX_FUNC_CNT, MAX_ENV_SIGNALS_PER_STEP>;
+  using func_usage_t = FunctionUsage<MAX_FUNC_CNT>;
+  using batch_program_t = batch_hw_t::Program;
+  // - Evaluation aliases
+  using trial_runner_t = void (Experiment::*)(EvalContext &, Agent &);
 
   struct Genome {
-    program_t program;
+    std::shared_ptr<const packed_program_t> program; ///< Packed program, shared (read-only) between copies of this genome.
+    std::shared_ptr<const program_t> unpacked;       ///< Same program unpacked (null unless Experiment::KeepUnpackedPrograms()).
     double sim_thresh;
+    TagBindings env_bindings; ///< Environment/distraction tag => best matching functions (see Experiment::BindEnvTags).
 
-    Genome(const program_t & _p, double _s=0) : program(_p), sim_thresh(_s) { ; }
-    Genome(const Genome && in) : program(in.program), sim_thresh(in.sim_thresh) { ; }
-    Genome(const Genome & in) : program(in.program), sim_thresh(in.sim_thresh) { ; } 
+    /// Trial-independent traits of the genome (see Experiment::ComputeGenomeTraits).
+    struct Traits {
+      bool valid;
+      size_t func_cnt;
+      double inst_entropy;
+      emp::vector<uint32_t> inst_histogram;  ///< Instruction ID => number of occurrences in program.
+
+      Traits() : valid(false), func_cnt(0), inst_entropy(0), inst_histogram() { ; }
+    };
+    Traits traits;
+
+    Genome(std::shared_ptr<const packed_program_t> _p, double _s=0, std::shared_ptr<const program_t> _u=nullptr)
+      : program(std::move(_p)), unpacked(std::move(_u)), sim_thresh(_s), env_bindings(), traits() { ; }
+    Genome(Genome && in)
+      : program(std::move(in.program)), unpacked(std::move(in.unpacked)), sim_thresh(in.sim_thresh),
+        env_bindings(std::move(in.env_bindings)), traits(std::move(in.traits)) { ; }
+    Genome(const Genome & in)
+      : program(in.program), unpacked(in.unpacked), sim_thresh(in.sim_thresh), env_bindings(in.env_bindings),
+        traits(in.traits) { ; }
+
+    Genome & operator=(Genome && in) = default;
+    Genome & operator=(const Genome & in) = default;
+
+    const packed_program_t & GetProgram() const { return *program; }
+
+    /// Is everything derived from this genome's program (tag bindings, traits) up to date?
+    bool IsPrepared() const { return env_bindings.IsBuilt() && traits.valid; }
+
+    /// Structural hash of the genome (instructions, arguments, tags, and similarity threshold).
+    uint64_t GetHash() const {
+      const packed_program_t & prog = GetProgram();
+      const uint64_t * words = prog.GetWords();
+      uint64_t hash = MixStreamKey(prog.GetSize());
+      for (size_t i = 0; i < prog.GetWordCnt(); ++i) hash = MixStreamKey(hash ^ words[i]);
+      uint64_t thresh_bits = 0;
+      std::memcpy(&thresh_bits, &sim_thresh, sizeof(thresh_bits));
+      return MixStreamKey(hash ^ thresh_bits);
+    }
+
+    /// Are two genomes structurally identical?
+    bool operator==(const Genome & other) const {
+      if (sim_thresh != other.sim_thresh) return false;
+      if (program == other.program) return true;  // Shared program.
+      return GetProgram() == other.GetProgram();
+    }
 
   };
 
@@ -103,11 +226,14 @@ public:
     size_t agent_id;
     genome_t genome;
 
-    Agent(const program_t & _p, double _s=0) : agent_id(0), genome(_p, _s) { ; }
+    Agent(std::shared_ptr<const packed_program_t> _p, double _s=0) : agent_id(0), genome(std::move(_p), _s) { ; }
     Agent(const genome_t & _g) : agent_id(0), genome(_g) { ; }
-    Agent(const Agent && in) : agent_id(in.GetID()), genome(in.genome) { ; }
+    Agent(Agent && in) : agent_id(in.GetID()), genome(std::move(in.genome)) { ; }
     Agent(const Agent & in) : agent_id(in.GetID()), genome(in.genome) { ; }
 
+    Agent & operator=(Agent && in) = default;
+    Agent & operator=(const Agent & in) = default;
+
     size_t GetID() const { return agent_id; }
     void SetID(size_t id) { agent_id = id; }
 
@@ -115,156 +241,212 @@ public:
     void SetSimilarityThreshold(double val) { genome.sim_thresh = val; }
 
     genome_t & GetGenome() { return genome; }
-    program_t & GetProgram() { return genome.program; }
+    const packed_program_t & GetProgram() const { return genome.GetProgram(); }
 
   };
   // TODO: reset phenotype on begin trial... 
   /// Phenotype of agents being evolved.
-  struct Phenotype {
-    double env_match_score;
-    size_t functions_used;
-    size_t function_cnt;
-    double inst_entropy;
-    double sim_thresh;
+  ///  - Lightweight handle to a single (agent, evaluation) entry in a PhenotypeCache; pass it around by value.
+  class Phenotype {
+    protected:
+      emp::Ptr<phen_cache_t> cache;
+      size_t phen_id;     ///< Entry in cache (agent_id * eval_cnt + eval_id).
 
-    double score;
-
-    size_t task_cnt;
-    size_t time_all_tasks_credited;
-    size_t total_wasted_completions;
-    size_t unique_tasks_credited;
-    size_t unique_tasks_completed;
-
-    emp::vector<size_t> wasted_completions_by_task;
-    emp::vector<size_t> credited_by_task;
-    emp::vector<size_t> completed_by_task;
-
-
-    Phenotype(size_t _task_cnt=0) 
-      : env_match_score(0),
-        functions_used(0),
-        function_cnt(0),
-        inst_entropy(0),
-        sim_thresh(0),
-        score(0),
-        task_cnt(_task_cnt),
-        time_all_tasks_credited(0),
-        total_wasted_completions(0),
-        unique_tasks_credited(0),
-        unique_tasks_completed(0),
-        wasted_completions_by_task(task_cnt),
-        credited_by_task(task_cnt),
-        completed_by_task(task_cnt)
-    { ; }
-
-    /// Zero out phenotype.
-    void Reset() {
-      env_match_score = 0;
-      functions_used = 0;
-      function_cnt = 0;
-      sim_thresh = 0;
-      score = 0;
-      time_all_tasks_credited = 0;
-      total_wasted_completions = 0;
-      unique_tasks_credited = 0;
-      unique_tasks_completed = 0;
-      inst_entropy = 0;
-      for (size_t i = 0; i < task_cnt; ++i) {
-        wasted_completions_by_task[i] = 0;
-        credited_by_task[i] = 0;
-        completed_by_task[i] = 0;
-      }
-    }
-
-    void SetTaskCnt(size_t val) {
-      task_cnt = val;
-      wasted_completions_by_task.resize(task_cnt);
-      credited_by_task.resize(task_cnt);
-      completed_by_task.resize(task_cnt);
-      Reset();
-    }
-
-    double GetEnvMatchScore() const { return env_match_score; }
-    size_t GetFunctionsUsed() const { return functions_used; }
-    size_t GetFunctionCnt() const { return function_cnt; }
-    double GetInstEntropy() const { return inst_entropy; }
-    double GetSimilarityThreshold() const { return sim_thresh; }
-    double GetScore() const { return score; }
-    size_t GetTaskCnt() const { return task_cnt; }
-    size_t GetTimeAllTasksCredited() const { return time_all_tasks_credited; }
-    size_t GetTotalWastedCompletions() const { return total_wasted_completions; }
-    size_t GetUniqueTasksCredited() const { return unique_tasks_credited; }
-    size_t GetUniqueTasksCompleted() const { return unique_tasks_completed; }
-    size_t GetWastedCompletions(size_t task_id) const { 
-      emp_assert(task_id < wasted_completions_by_task.size());
-      return wasted_completions_by_task[task_id]; 
-    }
-    size_t GetCredited(size_t task_id) const { 
-      emp_assert(task_id < credited_by_task.size());
-      return credited_by_task[task_id]; 
-    }
-    size_t GetCompleted(size_t task_id) const { 
-      emp_assert(task_id < completed_by_task.size());
-      return completed_by_task[task_id]; 
-    }
-
-    void SetEnvMatchScore(double val) { env_match_score = val; }
-    void SetFunctionsUsed(size_t val) { functions_used = val; }
-    void SetFunctionCnt(size_t val) { function_cnt = val; }
-    void SetInstEntropy(double val) { inst_entropy = val; }
-    void SetSimilarityThreshold(double val) { sim_thresh = val; }
-    void SetScore(double val) { score = val; }
-
-    void SetTimeAllTasksCredited(size_t val) { time_all_tasks_credited = val; }
-    void SetTotalWastedCompletions(size_t val) { total_wasted_completions = val; }
-    void SetUniqueTasksCredited(size_t val) { unique_tasks_credited = val; }
-    void SetUniqueTasksCompleted(size_t val) { unique_tasks_completed = val; }
-    
-    void SetWastedCompletions(size_t task_id, size_t val) { 
-      emp_assert(task_id < wasted_completions_by_task.size());
-      wasted_completions_by_task[task_id] = val; 
-    }
-    void SetCredited(size_t task_id, size_t val) { 
-      emp_assert(task_id < credited_by_task.size());
-      credited_by_task[task_id] = val; 
-    }
-    void SetCompleted(size_t task_id, size_t val) { 
-      emp_assert(task_id < completed_by_task.size());
-      completed_by_task[task_id] = val; 
-    }
+    public:
+      Phenotype(emp::Ptr<phen_cache_t> _cache, size_t _id) : cache(_cache), phen_id(_id) { ; }
+
+      /// Zero out phenotype.
+      void Reset() { cache->ResetPhen(phen_id); }
+
+      double GetEnvMatchScore() const { return cache->env_match_score[phen_id]; }
+      size_t GetFunctionsUsed() const { return cache->functions_used[phen_id]; }
+      size_t GetFunctionCnt() const { return cache->function_cnt[phen_id]; }
+      double GetInstEntropy() const { return cache->inst_entropy[phen_id]; }
+      double GetSimilarityThreshold() const { return cache->sim_thresh[phen_id]; }
+      double GetScore() const { return cache->score[phen_id]; }
+      size_t GetTaskCnt() const { return cache->task_cnt; }
+      size_t GetTimeAllTasksCredited() const { return cache->time_all_tasks_credited[phen_id]; }
+      size_t GetTotalWastedCompletions() const { return cache->total_wasted_completions[phen_id]; }
+      size_t GetUniqueTasksCredited() const { return cache->unique_tasks_credited[phen_id]; }
+      size_t GetUniqueTasksCompleted() const { return cache->unique_tasks_completed[phen_id]; }
+      size_t GetWastedCompletions(size_t task_id) const { 
+        emp_assert(task_id < cache->task_cnt);
+        return cache->wasted_completions_by_task[cache->GetTaskSlot(phen_id, task_id)]; 
+      }
+      size_t GetCredited(size_t task_id) const { 
+        emp_assert(task_id < cache->task_cnt);
+        return cache->credited_by_task[cache->GetTaskSlot(phen_id, task_id)]; 
+      }
+      size_t GetCompleted(size_t task_id) const { 
+        emp_assert(task_id < cache->task_cnt);
+        return cache->completed_by_task[cache->GetTaskSlot(phen_id, task_id)]; 
+      }
+
+      void SetEnvMatchScore(double val) { cache->env_match_score[phen_id] = val; }
+      void SetFunctionsUsed(size_t val) { cache->functions_used[phen_id] = val; }
+      void SetFunctionCnt(size_t val) { cache->function_cnt[phen_id] = val; }
+      void SetInstEntropy(double val) { cache->inst_entropy[phen_id] = val; }
+      void SetSimilarityThreshold(double val) { cache->sim_thresh[phen_id] = val; }
+      void SetScore(double val) { cache->score[phen_id] = val; }
+
+      void SetTimeAllTasksCredited(size_t val) { cache->time_all_tasks_credited[phen_id] = val; }
+      void SetTotalWastedCompletions(size_t val) { cache->total_wasted_completions[phen_id] = val; }
+      void SetUniqueTasksCredited(size_t val) { cache->unique_tasks_credited[phen_id] = val; }
+      void SetUniqueTasksCompleted(size_t val) { cache->unique_tasks_completed[phen_id] = val; }
+      
+      void SetWastedCompletions(size_t task_id, size_t val) { 
+        emp_assert(task_id < cache->task_cnt);
+        cache->wasted_completions_by_task[cache->GetTaskSlot(phen_id, task_id)] = (uint32_t)val; 
+      }
+      void SetCredited(size_t task_id, size_t val) { 
+        emp_assert(task_id < cache->task_cnt);
+        cache->credited_by_task[cache->GetTaskSlot(phen_id, task_id)] = (uint32_t)val; 
+      }
+      void SetCompleted(size_t task_id, size_t val) { 
+        emp_assert(task_id < cache->task_cnt);
+        cache->completed_by_task[cache->GetTaskSlot(phen_id, task_id)] = (uint32_t)val; 
+      }
 
-    void IncEnvMatchScore(double val=1.0) { env_match_score += val; }
+      void IncEnvMatchScore(double val=1.0) { cache->env_match_score[phen_id] += val; }
 
   };
 
   /// Utility class used to cache phenotypes during population evaluation.
+  ///  - Columnar storage: one contiguous array per phenotype field, indexed by (agent_id * eval_cnt + eval_id).
+  ///  - Per-task counters live in [agent][eval][task] blocks.
   class PhenotypeCache {
+    friend class Phenotype;
+
     protected:
       size_t agent_cnt;
       size_t eval_cnt;
-      emp::vector<phenotype_t> agent_phen_cache;
+      size_t task_cnt;
+
+      emp::vector<double> env_match_score;
+      emp::vector<size_t> functions_used;
+      emp::vector<size_t> function_cnt;
+      emp::vector<double> inst_entropy;
+      emp::vector<double> sim_thresh;
+      emp::vector<double> score;
+      emp::vector<size_t> time_all_tasks_credited;
+      emp::vector<size_t> total_wasted_completions;
+      emp::vector<size_t> unique_tasks_credited;
+      emp::vector<size_t> unique_tasks_completed;
+
+      emp::vector<uint32_t> wasted_completions_by_task;
+      emp::vector<uint32_t> credited_by_task;
+      emp::vector<uint32_t> completed_by_task;
+
       emp::vector<size_t> agent_representative_eval;
 
+      size_t GetPhenID(size_t agent_id, size_t eval_id) const { return (agent_id * eval_cnt) + eval_id; }
+      size_t GetTaskSlot(size_t phen_id, size_t task_id) const { return (phen_id * task_cnt) + task_id; }
+
+      /// Zero out phenotypes [begin, end).
+      void ResetPhens(size_t begin, size_t end) {
+        std::fill(env_match_score.begin() + begin, env_match_score.begin() + end, 0.0);
+        std::fill(functions_used.begin() + begin, functions_used.begin() + end, 0);
+        std::fill(function_cnt.begin() + begin, function_cnt.begin() + end, 0);
+        std::fill(inst_entropy.begin() + begin, inst_entropy.begin() + end, 0.0);
+        std::fill(sim_thresh.begin() + begin, sim_thresh.begin() + end, 0.0);
+        std::fill(score.begin() + begin, score.begin() + end, 0.0);
+        std::fill(time_all_tasks_credited.begin() + begin, time_all_tasks_credited.begin() + end, 0);
+        std::fill(total_wasted_completions.begin() + begin, total_wasted_completions.begin() + end, 0);
+        std::fill(unique_tasks_credited.begin() + begin, unique_tasks_credited.begin() + end, 0);
+        std::fill(unique_tasks_completed.begin() + begin, unique_tasks_completed.begin() + end, 0);
+        const size_t task_begin = begin * task_cnt, task_end = end * task_cnt;
+        std::fill(wasted_completions_by_task.begin() + task_begin, wasted_completions_by_task.begin() + task_end, 0);
+        std::fill(credited_by_task.begin() + task_begin, credited_by_task.begin() + task_end, 0);
+        std::fill(completed_by_task.begin() + task_begin, completed_by_task.begin() + task_end, 0);
+      }
+
+      void ResetPhen(size_t phen_id) { ResetPhens(phen_id, phen_id + 1); }
+
+      /// Copy phenotypes [from, from + cnt) onto [to, to + cnt).
+      void CopyPhens(size_t from, size_t to, size_t cnt) {
+        std::copy_n(env_match_score.begin() + from, cnt, env_match_score.begin() + to);
+        std::copy_n(functions_used.begin() + from, cnt, functions_used.begin() + to);
+        std::copy_n(function_cnt.begin() + from, cnt, function_cnt.begin() + to);
+        std::copy_n(inst_entropy.begin() + from, cnt, inst_entropy.begin() + to);
+        std::copy_n(sim_thresh.begin() + from, cnt, sim_thresh.begin() + to);
+        std::copy_n(score.begin() + from, cnt, score.begin() + to);
+        std::copy_n(time_all_tasks_credited.begin() + from, cnt, time_all_tasks_credited.begin() + to);
+        std::copy_n(total_wasted_completions.begin() + from, cnt, total_wasted_completions.begin() + to);
+        std::copy_n(unique_tasks_credited.begin() + from, cnt, unique_tasks_credited.begin() + to);
+        std::copy_n(unique_tasks_completed.begin() + from, cnt, unique_tasks_completed.begin() + to);
+        const size_t task_from = from * task_cnt, task_to = to * task_cnt, task_slots = cnt * task_cnt;
+        std::copy_n(wasted_completions_by_task.begin() + task_from, task_slots, wasted_completions_by_task.begin() + task_to);
+        std::copy_n(credited_by_task.begin() + task_from, task_slots, credited_by_task.begin() + task_to);
+        std::copy_n(completed_by_task.begin() + task_from, task_slots, completed_by_task.begin() + task_to);
+      }
+
+      /// Size every phenotype field for agent_cnt * eval_cnt phenotypes.
+      void ResizeStorage() {
+        const size_t phen_cnt = agent_cnt * eval_cnt;
+        env_match_score.resize(phen_cnt);
+        functions_used.resize(phen_cnt);
+        function_cnt.resize(phen_cnt);
+        inst_entropy.resize(phen_cnt);
+        sim_thresh.resize(phen_cnt);
+        score.resize(phen_cnt);
+        time_all_tasks_credited.resize(phen_cnt);
+        total_wasted_completions.resize(phen_cnt);
+        unique_tasks_credited.resize(phen_cnt);
+        unique_tasks_completed.resize(phen_cnt);
+        wasted_completions_by_task.resize(phen_cnt * task_cnt);
+        credited_by_task.resize(phen_cnt * task_cnt);
+        completed_by_task.resize(phen_cnt * task_cnt);
+      }
+
     public:
       PhenotypeCache(size_t _agent_cnt, size_t _eval_cnt) 
-        : agent_cnt(_agent_cnt), eval_cnt(_eval_cnt), 
-          agent_phen_cache(agent_cnt * eval_cnt),
-          agent_representative_eval(agent_cnt, 0)
-      { ; }
-
-      /// Resize phenotype cache. 
+        : agent_cnt(0), eval_cnt(0), task_cnt(0),
+          env_match_score(), functions_used(), function_cnt(), inst_entropy(), sim_thresh(), score(),
+          time_all_tasks_credited(), total_wasted_completions(), unique_tasks_credited(), unique_tasks_completed(),
+          wasted_completions_by_task(), credited_by_task(), completed_by_task(),
+          agent_representative_eval()
+      { Resize(_agent_cnt, _eval_cnt); }
+
+      /// Resize phenotype cache (zeroes every phenotype).
       void Resize(size_t _agent_cnt, size_t _eval_cnt) {
         agent_cnt = _agent_cnt;
         eval_cnt = _eval_cnt;
-        agent_phen_cache.clear();
-        agent_phen_cache.resize(agent_cnt * eval_cnt);
+        ResizeStorage();
         agent_representative_eval.clear();
         agent_representative_eval.resize(agent_cnt, 0);
+        Reset();
+      }
+
+      /// Grow phenotype cache to (at least) _agent_cnt agents, keeping every existing phenotype (new ones are zeroed).
+      void Grow(size_t _agent_cnt) {
+        if (_agent_cnt <= agent_cnt) return;
+        const size_t old_phen_cnt = agent_cnt * eval_cnt;
+        agent_cnt = _agent_cnt;
+        ResizeStorage();
+        agent_representative_eval.resize(agent_cnt, 0);
+        ResetPhens(old_phen_cnt, agent_cnt * eval_cnt);
+      }
+
+      /// Set number of tasks tracked by every phenotype (zeroes every phenotype).
+      void SetTaskCnt(size_t _task_cnt) {
+        task_cnt = _task_cnt;
+        Resize(agent_cnt, eval_cnt);
       }
 
+      /// Zero out every phenotype.
+      void Reset() { ResetPhens(0, agent_cnt * eval_cnt); }
+
+      /// Zero out every evaluation of a single agent.
+      void ResetAgent(size_t agent_id) {
+        emp_assert(agent_id < agent_cnt);
+        ResetPhens(GetPhenID(agent_id, 0), GetPhenID(agent_id + 1, 0));
+      }
+
+      size_t GetTaskCnt() const { return task_cnt; }
+
       /// Access a phenotype from the cache
-      phenotype_t & Get(size_t agent_id, size_t eval_id) {
-        return agent_phen_cache[(agent_id * eval_cnt) + eval_id];
+      phenotype_t Get(size_t agent_id, size_t eval_id) {
+        return phenotype_t(this, GetPhenID(agent_id, eval_id));
       }
 
       size_t GetRepresentativeEval(size_t agent_id) {
@@ -272,23 +454,146 @@ public:
         return agent_representative_eval[agent_id];
       }
 
-      phenotype_t & GetRepresentativePhen(size_t agent_id) {
+      phenotype_t GetRepresentativePhen(size_t agent_id) {
         return Get(agent_id, agent_representative_eval[agent_id]);
       }
 
+      /// Copy every evaluation (and the representative evaluation) of one agent onto another.
+      void CopyAgent(size_t from_id, size_t to_id) {
+        emp_assert(from_id < agent_cnt && to_id < agent_cnt);
+        CopyPhens(GetPhenID(from_id, 0), GetPhenID(to_id, 0), eval_cnt);
+        agent_representative_eval[to_id] = agent_representative_eval[from_id];
+      }
+
       /// Set representative evaluation to worst-scoring evaluation.
       void SetRepresentativeEval(size_t agent_id) {
         emp_assert(agent_id < agent_cnt);
-        // agent_representative_eval[agent_id] = eval_id;
-        double score = Get(agent_id, 0).GetScore();
+        // Return the minimum score! (earliest evaluation wins ties; branch-free select)
+        const double * scores = score.data() + GetPhenID(agent_id, 0);
+        double min_score = scores[0];
         size_t repID = 0;
-        // Return the minimum score!
         for (size_t eID = 1; eID < eval_cnt; ++eID) {
-          phenotype_t & phen = Get(agent_id, eID);
-          if (phen.GetScore() < score) { score = phen.GetScore(); repID = eID; }
+          const bool lower = scores[eID] < min_score;
+          min_score = lower ? scores[eID] : min_score;
+          repID = lower ? eID : repID;
         }
         agent_representative_eval[agent_id] = repID;
-      }    
+      }
+
+      /// Set representative evaluation of every agent in [begin, end).
+      void SetRepresentativeEvals(size_t begin, size_t end) {
+        for (size_t aID = begin; aID < end; ++aID) SetRepresentativeEval(aID);
+      }
+  };
+
+  /// Precomputed timeline of everything the environment does during a single trial.
+  ///  - Events are stored in the order they must be applied (time, then change-before-distraction).
+  struct EnvSchedule {
+    /// A single environment change or distraction signal.
+    struct Event {
+      size_t time;          ///< Trial time at which event occurs.
+      size_t tag_id;        ///< Environment state ID (change) or distraction signal ID (distraction).
+      bool is_distraction;
+
+      Event(size_t _t, size_t _id, bool _d) : time(_t), tag_id(_id), is_distraction(_d) { ; }
+    };
+
+    std::array<task_io_t, MAX_TASK_NUM_INPUTS> task_inputs;
+    task_solutions_t task_solutions;  ///< Logic task solutions for task_inputs.
+    emp::vector<Event> events;
+
+    EnvSchedule() : task_inputs(), task_solutions(), events() {
+      for (size_t i = 0; i < MAX_TASK_NUM_INPUTS; ++i) task_inputs[i] = 0;
+      task_solutions.fill(0);
+    }
+
+    void Clear() { events.clear(); }
+    void AddChange(size_t time, size_t state) { events.emplace_back(time, state, false); }
+    void AddDistraction(size_t time, size_t sig_id) { events.emplace_back(time, sig_id, true); }
+  };
+
+  /// Everything needed to run agent trials independently of other evaluations.
+  ///  - Each evaluation worker owns exactly one evaluation context.
+  ///  - Experiment-specific instructions find their context via the TRAIT_ID__EVAL_CTX hardware trait.
+  struct EvalContext {
+    size_t ctx_id;
+    emp::Ptr<emp::Random> random; ///< Random number generator used during evaluation.
+    emp::Ptr<hardware_t> hw;      ///< SignalGP virtual hardware used for evaluation.
+    emp::Ptr<program_t> program;  ///< Scratch space for unpacking programs whose genomes don't keep them unpacked.
+    bool owns_random;             ///< Is this context responsible for deleting its random number generator?
+
+    taskset_t task_set;
+    std::array<task_io_t, MAX_TASK_NUM_INPUTS> task_inputs;
+    size_t input_load_id;
+
+    size_t trial_id;
+    size_t trial_time;
+    size_t env_state;
+
+    size_t stream_agent_id; ///< Agent key of the current trial's random number stream (EVAL_RNG_MODE_ID__TRIAL_STREAMS).
+    size_t stream_trial_id; ///< Trial key of the current trial's random number stream (EVAL_RNG_MODE_ID__TRIAL_STREAMS).
+
+    emp::vector<size_t> env_shuffler; ///< Used for keeping track of shuffled environment cycling.
+    size_t env_shuffle_id;
+
+    func_usage_t functions_used;  ///< Functions called/spawned during current trial.
+
+    emp::Ptr<const env_schedule_t> env_schedule; ///< Environment schedule being replayed (ENVIRONMENT_COMMON_SCHEDULES).
+    size_t env_event_id;                         ///< Next event in env_schedule.
+    env_schedule_t scratch_schedule;             ///< Used for trials that don't replay a common schedule (e.g., snapshots).
+
+    emp::Ptr<batch_hw_t> batch_hw;                    ///< Lockstep hardware (only if EVAL_BATCH_SIZE > 1).
+    emp::vector<batch_program_t> batch_programs;      ///< Decoded program for each lane.
+    emp::vector<taskset_t> batch_task_sets;           ///< Tasks for each lane.
+    emp::vector<emp::Ptr<emp::Random>> batch_randoms; ///< Random number generator for each lane (EVAL_RNG_MODE_ID__TRIAL_STREAMS).
+    emp::vector<size_t> batch_ids;                    ///< Phenotype slot (agent ID) of each lane.
+    emp::vector<emp::Ptr<agent_t>> batch_agents;      ///< Agent loaded into each lane.
+
+    emp::Ptr<emp::Random> snapshot_random;  ///< Always owned; snapshot trials draw from it instead of random.
+
+    EvalContext(size_t _id, emp::Ptr<emp::Random> _rnd, bool _owns_rnd, const taskset_t & _tasks)
+      : ctx_id(_id), random(_rnd), hw(nullptr), program(nullptr), owns_random(_owns_rnd),
+        task_set(_tasks), task_inputs(),
+        input_load_id(0), trial_id(0), trial_time(0), env_state(0),
+        stream_agent_id(0), stream_trial_id(0),
+        env_shuffler(), env_shuffle_id(0), functions_used(),
+        env_schedule(nullptr), env_event_id(0), scratch_schedule(),
+        batch_hw(nullptr), batch_programs(), batch_task_sets(), batch_randoms(), batch_ids(),
+        batch_agents(), snapshot_random(emp::NewPtr<emp::Random>(1))
+    {
+      for (size_t i = 0; i < MAX_TASK_NUM_INPUTS; ++i) task_inputs[i] = 0;
+    }
+  };
+
+  /// Everything a thread needs to mutate genomes (see MutateProgram).
+  ///  - Context 0 handles serial mutation and puts new programs into the experiment's program arena. Every other
+  ///    context (parallel reproduction) owns its arena, so threads never allocate from the same one.
+  struct MutationContext {
+    emp::Ptr<packed_arena_t> arena;   ///< Where new packed programs go.
+    bool owns_arena;
+    emp::vector<uint64_t> pack_buffer;
+    emp::Ptr<program_t> program;      ///< Unpacked scratch program (per-site mutation sampling).
+    toolbelt::SignalGPMutator<hardware_t> mutator;
+    PackedMutator<TAG_WIDTH> packed_mutator;
+    emp::Random random;               ///< Reseeded for every chunk of offspring (parallel reproduction).
+
+    size_t offspring_cnt;   ///< Offspring mutated this update.
+    size_t copy_cnt;        ///< Offspring that needed a new (packed) program this update.
+    size_t unchanged_cnt;   ///< Offspring whose mutations left the program unchanged this update.
+
+    MutationContext(emp::Ptr<packed_arena_t> _arena, bool _owns_arena, emp::Ptr<inst_lib_t> _inst_lib,
+                    const toolbelt::SignalGPMutator<hardware_t> & _mutator, const PackedMutator<TAG_WIDTH> & _packed_mutator)
+      : arena(_arena), owns_arena(_owns_arena), pack_buffer(), program(emp::NewPtr<program_t>(_inst_lib)),
+        mutator(_mutator), packed_mutator(_packed_mutator), random(1),
+        offspring_cnt(0), copy_cnt(0), unchanged_cnt(0) { ; }
+    MutationContext(const MutationContext &) = delete;
+    MutationContext & operator=(const MutationContext &) = delete;
+    ~MutationContext() {
+      program.Delete();
+      if (owns_arena) arena.Delete();
+    }
+
+    void ResetCounts() { offspring_cnt = 0; copy_cnt = 0; unchanged_cnt = 0; }
   };
 
 protected:
@@ -305,6 +610,13 @@ protected:
   size_t TRIAL_CNT; 
   bool TASKS_ON; 
   bool EVOLVE_SIMILARITY_THRESH;
+  size_t EVAL_THREADS;
+  size_t EVAL_RNG_MODE;
+  size_t EVAL_BATCH_SIZE;
+  bool EVAL_DEDUPLICATE;
+  bool EVAL_IDLE_FAST_FORWARD;
+  bool EVAL_SIGNAL_HOOKS;
+  bool EVAL_FLAT_HARDWARE;
   // == ENVIRONMENT_GROUP ==
   size_t ENVIRONMENT_STATES; 
   size_t ENVIRONMENT_TAG_GENERATION_METHOD; 
@@ -315,16 +627,19 @@ protected:
   bool ENVIRONMENT_DISTRACTION_SIGNALS; 
   size_t ENVIRONMENT_DISTRACTION_SIGNAL_CNT;
   double ENVIRONMENT_DISTRACTION_SIGNAL_PROB;
+  bool ENVIRONMENT_COMMON_SCHEDULES;
   // == SELECTION_GROUP ==
   size_t TOURNAMENT_SIZE; 
   size_t SELECTION_METHOD; 
   size_t ELITE_SELECT__ELITE_CNT; 
+  size_t REPRODUCTION_THREADS;
   bool MAP_ELITES_AXIS__INST_ENTROPY; 
   bool MAP_ELITES_AXIS__FUNCTIONS_USED; 
   bool MAP_ELITES_AXIS__FUNCTION_CNT;
   bool MAP_ELITES_AXIS__SIMILARITY_THRESH; 
   size_t MAP_ELITES_AXIS_RES__INST_ENTROPY; 
   size_t MAP_ELITES_AXIS_RES__SIMILARITY_THRESH; 
+  size_t MAP_ELITES_BATCH_SIZE;
   // == SGP_PROGRAM_GROUP ==
   size_t SGP_PROG_MAX_FUNC_CNT; 
   size_t SGP_PROG_MIN_FUNC_CNT; 
@@ -348,6 +663,7 @@ protected:
   double SGP_MUT_PER_FUNC__SLIP_RATE; 
   double SGP_MUT_PER_FUNC__FUNC_DUP_RATE; 
   double SGP_MUT_PER_FUNC__FUNC_DEL_RATE; 
+  size_t SGP_MUT_SAMPLING_MODE;
   // == DATA_GROUP ==
   size_t SYSTEMATICS_INTERVAL; 
   size_t FITNESS_INTERVAL; 
@@ -366,24 +682,57 @@ protected:
   emp::Ptr<inst_lib_t> inst_lib;    ///< SignalGP instruction library
   emp::Ptr<event_lib_t> event_lib;  ///< SignalGP event library
 
-  emp::Ptr<hardware_t> eval_hw;     ///< SignalGP virtual hardware used for evaluation
+  packed_arena_t program_arena;         ///< Storage for every genome's (packed) program. Must outlive every genome.
+  emp::vector<uint64_t> pack_buffer;    ///< Scratch space for packing programs.
+
+  emp::vector<int> lockstep_opcodes;   ///< Lockstep hardware opcode of each instruction in inst_lib (-1: unsupported).
+  emp::vector<uint32_t> lockstep_imms; ///< Lockstep hardware immediate of each instruction in inst_lib.
+
+  emp::vector<emp::Ptr<eval_ctx_t>> eval_contexts; ///< One evaluation context per evaluation worker. Context 0 is used for serial evaluations.
 
   toolbelt::SignalGPMutator<hardware_t> mutator;
+  PackedMutator<TAG_WIDTH> packed_mutator;  ///< Used instead of mutator with SGP_MUT_SAMPLING_MODE=1.
+  emp::vector<emp::Ptr<mut_ctx_t>> mut_contexts; ///< One mutation context per reproduction worker (copies of the mutators above). Context 0 is used for serial mutation.
+
+  emp::vector<agent_t> next_gen;        ///< Next generation, built by parallel reproduction (see Reproduce).
+  emp::vector<double> repro_fitness;    ///< Fitness of every agent in the world (parallel reproduction).
+  emp::vector<size_t> repro_order;      ///< Scratch space for picking elites.
+
+  /// MAP-Elites axis (trait, range, and resolution), used to bin agents with MAP_ELITES_BATCH_SIZE > 0.
+  struct MapAxis {
+    std::function<double(agent_t &)> fun;
+    double min;
+    double max;
+    size_t bin_cnt;
+
+    MapAxis(const std::function<double(agent_t &)> & _fun, double _min, double _max, size_t _bin_cnt)
+      : fun(_fun), min(_min), max(_max), bin_cnt(_bin_cnt) { ; }
+  };
+  emp::vector<MapAxis> map_axes;
+  MapArchive map_archive;       ///< Occupied cells => archive slots (world positions, agent IDs, phenotype slots).
+  size_t map_capacity;          ///< Archive slots with phenotype storage (see ReserveMapSlots).
+  emp::vector<agent_t> map_offspring;             ///< Current batch of MAP-Elites offspring.
+  emp::vector<uint64_t> map_offspring_cells;      ///< Archive cell of each offspring in the current batch.
+  emp::vector<double> map_slot_fitness;           ///< Cached fitness of each archive slot's elite...
+  emp::vector<size_t> map_slot_fitness_update;    ///< ...valid if computed this update (see World::SetCache).
+  emp::vector<size_t> map_placed_slots;           ///< Slots that got a new elite during the current batch.
+  emp::vector<emp::Ptr<agent_t>> map_eval_agents; ///< Agents to evaluate in the current pass (see EvaluateAgents).
+  emp::vector<size_t> map_eval_stream_ids;
 
   emp::vector<tag_t> env_state_tags;        ///< Tags associated with each environment state.
   emp::vector<tag_t> distraction_sig_tags;  ///< Tags associated with distraction signals.
-  emp::vector<size_t> env_shuffler;         ///< Used for keeping track of shuffled environment cycling.
-  size_t env_shuffle_id;
-
+  emp::vector<env_schedule_t> env_schedules; ///< Environment schedules shared by every agent this update (one per trial).
 
-  taskset_t task_set;
-  std::array<task_io_t, MAX_TASK_NUM_INPUTS> task_inputs;
-  size_t input_load_id;
+  taskset_t task_set;   ///< Task library. Each evaluation context gets its own copy.
 
   size_t update;
-  size_t trial_id;
-  size_t trial_time;
-  size_t env_state;
+  size_t update_eval_cnt;   ///< How many agent evaluations have we done this update?
+  emp::vector<size_t> eval_ids;       ///< Agents that actually get evaluated this update.
+  emp::vector<size_t> eval_rep_ids;   ///< For every agent, the agent whose evaluation it shares (EVAL_DEDUPLICATE).
+  std::unordered_map<uint64_t, size_t> genome_reps; ///< Genome hash => first agent with that genome this update.
+  bool lockstep_fuse;             ///< Fuse superinstructions when decoding lockstep programs?
+  bool lockstep_on;               ///< Evaluate on lockstep hardware (if contexts have it)? Analyses switch engines with this.
+  int stream_seed;          ///< Root seed for per-trial random number streams.
 
   size_t max_pop_size;
 
@@ -391,7 +740,6 @@ protected:
   double best_score;
 
   double max_inst_entropy;
-  std::unordered_set<size_t> functions_used;
 
   phen_cache_t phen_cache;
 
@@ -407,19 +755,19 @@ protected:
   // Systematics signals
   emp::Signal<void(size_t)> do_pop_snapshot_sig;      ///< Triggered if we should take a snapshot of the population (as defined by POP_SNAPSHOT_INTERVAL). Should call appropriate functions to take snapshot.
 
-  emp::Signal<void(agent_t &)> begin_agent_eval_sig;  ///< Triggered at beginning of agent evaluation (might be multiple trials)
-  emp::Signal<void(agent_t &)> end_agent_eval_sig;  ///< Triggered at beginning of agent evaluation (might be multiple trials)
+  emp::Signal<void(eval_ctx_t &, agent_t &)> begin_agent_eval_sig;  ///< Triggered at beginning of agent evaluation (might be multiple trials)
+  emp::Signal<void(eval_ctx_t &, agent_t &)> end_agent_eval_sig;  ///< Triggered at beginning of agent evaluation (might be multiple trials)
   
-  emp::Signal<void(agent_t &)> begin_agent_trial_sig; ///< Triggered at the beginning of an agent trial.
-  emp::Signal<void(agent_t &)> do_agent_trial_sig; ///< Triggered at the beginning of an agent trial.
-  emp::Signal<void(agent_t &)> end_agent_trial_sig; ///< Triggered at the beginning of an agent trial.
+  emp::Signal<void(eval_ctx_t &, agent_t &)> begin_agent_trial_sig; ///< Triggered at the beginning of an agent trial.
+  emp::Signal<void(eval_ctx_t &, agent_t &)> do_agent_trial_sig; ///< Triggered at the beginning of an agent trial.
+  emp::Signal<void(eval_ctx_t &, agent_t &)> end_agent_trial_sig; ///< Triggered at the beginning of an agent trial.
 
-  emp::Signal<void(agent_t &)> do_agent_advance_sig; ///< When triggered, advance SignalGP evaluation hardware
-  emp::Signal<void(void)> do_env_advance_sig;
+  emp::Signal<void(eval_ctx_t &, agent_t &)> do_agent_advance_sig; ///< When triggered, advance SignalGP evaluation hardware
+  emp::Signal<void(eval_ctx_t &)> do_env_advance_sig;
 
 
   // A few flexible functors!
-  std::function<double(agent_t &)> calc_score;
+  std::function<double(eval_ctx_t &, agent_t &)> calc_score;
   
   // For MAP-Elites
   std::function<double(agent_t &)> inst_ent_fun;
@@ -428,28 +776,441 @@ protected:
   std::function<double(agent_t &)> get_sim_thresh_fun;
 
   std::function<size_t(agent_t &, emp::Random &)> mutate_agent;
+  std::function<size_t()> heap_alloc_cnt_fun;  ///< Heap allocations made by the process so far (see SetHeapAllocCounter).
+  emp::Ptr<program_t> scratch_program;  ///< Unpacked program for serial work on genomes (printing).
+
+  double offspring_time;      ///< Time (ms) spent creating offspring (selection, reproduction, and mutation) this update.
+  double snapshot_time;       ///< Time (ms) spent taking population snapshots this update (not part of offspring_time).
+
+  emp::vector<emp::Ptr<agent_t>> snapshot_agents; ///< Agents to snapshot (see EvaluateSnapshots)...
+  emp::vector<size_t> snapshot_stream_ids;        ///< ...and their random number stream keys.
+  emp::vector<double> snapshot_scores;            ///< Snapshot results: agent i's trial t at [i * trial_cnt + t].
+  emp::vector<size_t> snapshot_funcs_used;
+  emp::vector<uint32_t> snapshot_call_cnts;       ///< Agent i's calls to function f over all trials at [i * MAX_FUNC_CNT + f].
+
+  trial_runner_t trial_runner;  ///< Trial loop specialized for this run's environment configuration.
+
+  /// Draw logic task inputs (and their solutions), guaranteeing no solution collisions among the tasks.
+  void DrawTaskInputs(emp::Random & rnd, std::array<task_io_t, MAX_TASK_NUM_INPUTS> & inputs,
+                      task_solutions_t & sols) {
+    do {
+      inputs[0] = rnd.GetUInt(MIN_TASK_INPUT, MAX_TASK_INPUT);
+      inputs[1] = rnd.GetUInt(MIN_TASK_INPUT, MAX_TASK_INPUT);
+      sols = LogicTaskSolutions(inputs[0], inputs[1]);
+    } while (HasLogicTaskCollision(sols));
+  }
 
   /// Reset logic tasks, guaranteeing no solution collisions among the tasks.
-  void ResetTasks() {
-    task_inputs[0] = random->GetUInt(MIN_TASK_INPUT, MAX_TASK_INPUT);
-    task_inputs[1] = random->GetUInt(MIN_TASK_INPUT, MAX_TASK_INPUT);
-    task_set.SetInputs(task_inputs);
-    while (task_set.IsCollision()) {
-      task_inputs[0] = random->GetUInt(MIN_TASK_INPUT, MAX_TASK_INPUT);
-      task_inputs[1] = random->GetUInt(MIN_TASK_INPUT, MAX_TASK_INPUT);
-      task_set.SetInputs(task_inputs);
+  void ResetTasks(eval_ctx_t & ctx) {
+    task_solutions_t sols;
+    DrawTaskInputs(*ctx.random, ctx.task_inputs, sols);
+    ctx.task_set.SetSolutions(sols.data());
+  }
+
+  /// Generate an environment schedule for a single trial.
+  ///  - Draws random numbers in the same order as the live environment (ResetTasks, shuffle, per-step changes/distractions).
+  void GenerateEnvSchedule(emp::Random & rnd, env_schedule_t & sched) {
+    sched.Clear();
+    // Task inputs (guaranteed to have no solution collisions).
+    DrawTaskInputs(rnd, sched.task_inputs, sched.task_solutions);
+    // Environment changes and distraction signals.
+    emp::vector<size_t> shuffler(env_state_tags.size());
+    for (size_t i = 0; i < shuffler.size(); ++i) shuffler[i] = i;
+    size_t shuffle_id = 0;
+    if (ENVIRONMENT_CHANGE_METHOD == ENV_CHG_METHOD_ID__SHUFFLED) emp::Shuffle(rnd, shuffler);
+    size_t state = (size_t)-1;
+    for (size_t t = 0; t < EVAL_TIME; ++t) {
+      switch (ENVIRONMENT_CHANGE_METHOD) {
+        case ENV_CHG_METHOD_ID__RANDOM: {
+          if (state == (size_t)-1 || rnd.P(ENVIRONMENT_CHANGE_PROB)) {
+            state = rnd.GetUInt(ENVIRONMENT_STATES);
+            sched.AddChange(t, state);
+          }
+          break;
+        }
+        case ENV_CHG_METHOD_ID__SHUFFLED: {
+          if (state == (size_t)-1 || rnd.P(ENVIRONMENT_CHANGE_PROB)) {
+            state = shuffler[shuffle_id];
+            shuffle_id += 1;
+            if (shuffle_id >= ENVIRONMENT_STATES) {
+              shuffle_id = 0;
+              emp::Shuffle(rnd, shuffler);
+            }
+            sched.AddChange(t, state);
+          }
+          // Like the live environment's configuration, shuffled cycling also picks up regular interval changes.
+        }
+        case ENV_CHG_METHOD_ID__REGULAR: {
+          if (state == (size_t)-1 || ((t % ENVIRONMENT_CHANGE_INTERVAL) == 0)) {
+            state = rnd.GetUInt(ENVIRONMENT_STATES);
+            sched.AddChange(t, state);
+          }
+          break;
+        }
+      }
+      if (ENVIRONMENT_DISTRACTION_SIGNALS && rnd.P(ENVIRONMENT_DISTRACTION_SIGNAL_PROB)) {
+        sched.AddDistraction(t, rnd.GetUInt(distraction_sig_tags.size()));
+      }
+    }
+  }
+
+  /// Generate this update's common environment schedules (one per trial).
+  void GenerateEnvSchedules() {
+    env_schedules.resize(TRIAL_CNT);
+    for (size_t tID = 0; tID < TRIAL_CNT; ++tID) {
+      if (EVAL_RNG_MODE == EVAL_RNG_MODE_ID__TRIAL_STREAMS) {
+        emp::Random sched_rnd(GetStreamSeed(stream_seed, update, (uint64_t)-1, tID));
+        GenerateEnvSchedule(sched_rnd, env_schedules[tID]);
+      } else {
+        GenerateEnvSchedule(*random, env_schedules[tID]);
+      }
+    }
+  }
+
+  /// Point evaluation context at the environment schedule for its current trial and load the trial's tasks.
+  ///  - Regular trials replay this update's common schedules.
+  ///  - Extra trials (e.g., snapshots) get a freshly generated schedule.
+  void BeginEnvSchedule(eval_ctx_t & ctx) {
+    if (ctx.stream_trial_id < env_schedules.size()) {
+      ctx.env_schedule = &env_schedules[ctx.stream_trial_id];
+    } else {
+      GenerateEnvSchedule(*ctx.random, ctx.scratch_schedule);
+      ctx.env_schedule = &ctx.scratch_schedule;
+    }
+    ctx.env_event_id = 0;
+    ctx.task_inputs = ctx.env_schedule->task_inputs;
+    ctx.task_set.SetSolutions(ctx.env_schedule->task_solutions.data());
+  }
+
+  /// Time of the next event in the context's environment schedule (EVAL_TIME if there are none left).
+  size_t GetNextEnvEventTime(eval_ctx_t & ctx) const {
+    const env_schedule_t & sched = *ctx.env_schedule;
+    if (ctx.env_event_id < sched.events.size()) return emp::Min(sched.events[ctx.env_event_id].time, EVAL_TIME);
+    return EVAL_TIME;
+  }
+
+  /// Binding tag ID of a distraction signal (environment states come first).
+  size_t GetDistractionTagID(size_t sig_id) const { return env_state_tags.size() + sig_id; }
+
+  /// Precompute which functions every environment/distraction tag binds to for the given genome.
+  ///  - Must be redone whenever the genome's program or similarity threshold changes.
+  void BindEnvTags(genome_t & genome) {
+    const packed_program_t & prog = genome.GetProgram();
+    emp_assert(prog.GetSize() <= MAX_FUNC_CNT);
+    std::array<tag_t, MAX_FUNC_CNT> func_tags;
+    prog.ForEachFunction([&func_tags](size_t fID, uint32_t tag, const uint64_t * insts, size_t len) {
+      func_tags[fID].SetUInt(0, tag);
+    });
+    const double thresh = (EVOLVE_SIMILARITY_THRESH) ? genome.sim_thresh : SGP_HW_MIN_BIND_THRESH;
+    const size_t env_tag_cnt = env_state_tags.size();
+    genome.env_bindings.Build(env_tag_cnt + distraction_sig_tags.size(), prog.GetSize(), thresh,
+      [this, &func_tags, env_tag_cnt](size_t tag_id, size_t fID) {
+        const tag_t & tag = (tag_id < env_tag_cnt) ? env_state_tags[tag_id] : distraction_sig_tags[tag_id - env_tag_cnt];
+        return emp::SimpleMatchCoeff(func_tags[fID], tag);
+      });
+  }
+
+  /// Compute trial-independent genome traits: function count, instruction histogram, and instruction entropy.
+  ///  - Must be redone whenever the genome's program changes.
+  void ComputeGenomeTraits(genome_t & genome) {
+    genome_t::Traits & traits = genome.traits;
+    const packed_program_t & prog = genome.GetProgram();
+    traits.func_cnt = prog.GetSize();
+    traits.inst_histogram.resize(inst_lib->GetSize());
+    std::fill(traits.inst_histogram.begin(), traits.inst_histogram.end(), 0);
+    const size_t inst_cnt = prog.GetInstCnt();
+    prog.ForEachFunction([&traits](size_t fID, uint32_t tag, const uint64_t * insts, size_t len) {
+      for (size_t i = 0; i < len; ++i) ++traits.inst_histogram[packed_program_t::GetInstID(insts[i])];
+    });
+    // Same as emp::ShannonEntropy over the program's instruction sequence.
+    double ent = 0;
+    for (size_t id = 0; id < traits.inst_histogram.size(); ++id) {
+      if (!traits.inst_histogram[id]) continue;
+      const double p = (double)traits.inst_histogram[id] / (double)inst_cnt;
+      ent += p * emp::Log2(p);
+    }
+    ent = -1 * ent;
+    traits.inst_entropy = (ent < 0.0) ? 0.0 : ent;
+    traits.valid = true;
+  }
+
+  /// Bring everything derived from a genome's program up to date (tag bindings and traits).
+  ///  - Call whenever a genome is created or mutated.
+  void PrepareGenome(genome_t & genome) {
+    BindEnvTags(genome);
+    ComputeGenomeTraits(genome);
+  }
+
+  /// Handle an environment signal using precomputed tag bindings.
+  /// Same outcome as an EnvSignal event handled by HandleEvent__EnvSignal_ED, without tag matching.
+  void SpawnBoundCore(eval_ctx_t & ctx, const TagBindings & bindings, size_t tag_id) {
+    hardware_t & hw = *ctx.hw;
+    if (hw.GetActiveCores().size() + hw.GetPendingCores().size() >= hw.GetMaxCores()) return; // No free cores.
+    const size_t match_cnt = bindings.GetMatchCnt(tag_id);
+    if (!match_cnt) return;
+    const uint32_t * matches = bindings.GetMatches(tag_id);
+    const size_t fID = (match_cnt == 1) ? matches[0] : matches[ctx.random->GetUInt(0, match_cnt)];
+    ctx.functions_used.Mark(fID);
+    hw.SpawnCore(fID, memory_t(), false);
+  }
+
+  /// Find the function that best matches the given affinity (ties broken randomly, as EventDrivenGP does).
+  /// Return (size_t)-1 if nothing matches.
+  ///  - Ties are broken with the evaluation context's generator (the hardware's own, except during snapshot trials).
+  size_t FindBestFunction(hardware_t & hw, const tag_t & affinity, double threshold) {
+    const emp::vector<size_t> best_matches(hw.FindBestFuncMatch(affinity, threshold));
+    if (best_matches.empty()) return (size_t)-1;
+    if (best_matches.size() == 1) return best_matches[0];
+    return best_matches[GetEvalContext(hw).random->GetUInt(0, best_matches.size())];
+  }
+
+  /// Spawn a core on the function that best matches the given affinity, recording function usage.
+  /// Same outcome as EventDrivenGP::SpawnCore(affinity, threshold, input_mem, false).
+  void SpawnMatchedCore(hardware_t & hw, const tag_t & affinity, double threshold, const memory_t & input_mem) {
+    if (hw.GetActiveCores().size() + hw.GetPendingCores().size() >= hw.GetMaxCores()) return; // No free cores.
+    const size_t fID = FindBestFunction(hw, affinity, threshold);
+    if (fID == (size_t)-1) return;
+    GetEvalContext(hw).functions_used.Mark(fID);
+    hw.SpawnCore(fID, input_mem, false);
+  }
+
+  /// Run a single trial, replaying the trial's environment schedule (ENVIRONMENT_COMMON_SCHEDULES).
+  ///  - Specialized at compile time on whether environment signals do anything and on idle fast-forwarding.
+  template<bool ENV_SIGNALS, bool FAST_FORWARD>
+  void RunTrial__Schedule(eval_ctx_t & ctx, agent_t & agent) {
+    hardware_t & hw = *ctx.hw;
+    const env_schedule_t & sched = *ctx.env_schedule;
+    const TagBindings & bindings = agent.GetGenome().env_bindings;
+    phenotype_t phen = phen_cache.Get(agent.GetID(), ctx.trial_id);
+    for (ctx.trial_time = 0; ctx.trial_time < EVAL_TIME; ++ctx.trial_time) {
+      // 1) Advance environment.
+      while (ctx.env_event_id < sched.events.size() && sched.events[ctx.env_event_id].time == ctx.trial_time) {
+        const env_schedule_t::Event & event = sched.events[ctx.env_event_id];
+        if (event.is_distraction) {
+          if (ENV_SIGNALS) SpawnBoundCore(ctx, bindings, GetDistractionTagID(event.tag_id));
+        } else {
+          ctx.env_state = event.tag_id;
+          if (ENV_SIGNALS) SpawnBoundCore(ctx, bindings, ctx.env_state);
+        }
+        ++ctx.env_event_id;
+      }
+      // 2) Advance agent.
+      hw.SingleProcess();
+      const bool in_state = ((size_t)hw.GetTrait(TRAIT_ID__STATE) == ctx.env_state);
+      if (in_state) phen.IncEnvMatchScore();
+      // 3) Idle hardware can't do anything until the next environment event: skip ahead.
+      if (!FAST_FORWARD || hw.GetActiveCores().size() || hw.GetEventQueue().size()) continue;
+      const size_t next_time = GetNextEnvEventTime(ctx);
+      const size_t skipped = next_time - ctx.trial_time - 1;
+      if (skipped && in_state) phen.IncEnvMatchScore(skipped);
+      ctx.trial_time = next_time - 1;
+    }
+  }
+
+  /// Run a single trial in a live environment (drawing environment changes as the trial goes).
+  ///  - Specialized at compile time on environment change method, environment signals, and distraction signals.
+  ///  - Shuffled environments also get regular-interval changes (same as the signal-driven environment).
+  ///  - Signals are queued while the environment advances and handled when the agent steps (as queued EnvSignal
+  ///    events are), so function tie-breaks are drawn after the step's environment draws.
+  template<bool ENV_SIGNALS, size_t CHG_METHOD, bool DISTRACTIONS>
+  void RunTrial__Live(eval_ctx_t & ctx, agent_t & agent) {
+    hardware_t & hw = *ctx.hw;
+    emp::Random & rnd = *ctx.random;
+    const TagBindings & bindings = agent.GetGenome().env_bindings;
+    phenotype_t phen = phen_cache.Get(agent.GetID(), ctx.trial_id);
+    size_t signals[MAX_ENV_SIGNALS_PER_STEP];
+    size_t signal_cnt = 0;
+    for (ctx.trial_time = 0; ctx.trial_time < EVAL_TIME; ++ctx.trial_time) {
+      // 1) Advance environment.
+      if (CHG_METHOD == ENV_CHG_METHOD_ID__RANDOM) {
+        if (ctx.env_state == (size_t)-1 || rnd.P(ENVIRONMENT_CHANGE_PROB)) {
+          ctx.env_state = rnd.GetUInt(ENVIRONMENT_STATES);
+          if (ENV_SIGNALS) signals[signal_cnt++] = ctx.env_state;
+        }
+      }
+      if (CHG_METHOD == ENV_CHG_METHOD_ID__SHUFFLED) {
+        if (ctx.env_state == (size_t)-1 || rnd.P(ENVIRONMENT_CHANGE_PROB)) {
+          ctx.env_state = ctx.env_shuffler[ctx.env_shuffle_id];
+          ctx.env_shuffle_id += 1;
+          if (ctx.env_shuffle_id >= ENVIRONMENT_STATES) {
+            ctx.env_shuffle_id = 0;
+            emp::Shuffle(rnd, ctx.env_shuffler);
+          }
+          if (ENV_SIGNALS) signals[signal_cnt++] = ctx.env_state;
+        }
+      }
+      if (CHG_METHOD == ENV_CHG_METHOD_ID__SHUFFLED || CHG_METHOD == ENV_CHG_METHOD_ID__REGULAR) {
+        if (ctx.env_state == (size_t)-1 || ((ctx.trial_time % ENVIRONMENT_CHANGE_INTERVAL) == 0)) {
+          ctx.env_state = rnd.GetUInt(ENVIRONMENT_STATES);
+          if (ENV_SIGNALS) signals[signal_cnt++] = ctx.env_state;
+        }
+      }
+      if (DISTRACTIONS) {
+        if (rnd.P(ENVIRONMENT_DISTRACTION_SIGNAL_PROB)) {
+          const size_t id = rnd.GetUInt(distraction_sig_tags.size());
+          if (ENV_SIGNALS) signals[signal_cnt++] = GetDistractionTagID(id);
+        }
+      }
+      // 2) Advance agent.
+      for (size_t i = 0; i < signal_cnt; ++i) SpawnBoundCore(ctx, bindings, signals[i]);
+      signal_cnt = 0;
+      hw.SingleProcess();
+      if ((size_t)hw.GetTrait(TRAIT_ID__STATE) == ctx.env_state) phen.IncEnvMatchScore();
+    }
+  }
+
+  template<bool ENV_SIGNALS>
+  trial_runner_t GetTrialRunner();
+
+  /// Evaluate given agent using the given evaluation context.
+  ///  - stream_agent_id identifies the agent's random number streams (only used with per-trial streams).
+  void Evaluate(eval_ctx_t & ctx, agent_t & agent, size_t stream_agent_id) {
+    ctx.stream_agent_id = stream_agent_id;
+    begin_agent_eval_sig.Trigger(ctx, agent);
+    for (ctx.trial_id = 0; ctx.trial_id < TRIAL_CNT; ++ctx.trial_id) {
+      ctx.stream_trial_id = ctx.trial_id;
+      begin_agent_trial_sig.Trigger(ctx, agent);
+      do_agent_trial_sig.Trigger(ctx, agent);
+      end_agent_trial_sig.Trigger(ctx, agent);
+    }
+    end_agent_eval_sig.Trigger(ctx, agent);
+  }
+
+  /// Evaluate given agent using the given evaluation context. Random number streams are keyed by agent ID.
+  void Evaluate(eval_ctx_t & ctx, agent_t & agent) { Evaluate(ctx, agent, agent.GetID()); }
+
+  /// Record everything that must be recorded post-trial into the agent's phenotype for the current trial.
+  void RecordTrial(eval_ctx_t & ctx, agent_t & agent, taskset_t & tasks, size_t functions_used) {
+    phenotype_t phen = phen_cache.Get(agent.GetID(), ctx.trial_id);
+    phen.SetFunctionsUsed(functions_used);
+    phen.SetFunctionCnt(agent.GetGenome().traits.func_cnt);
+    phen.SetInstEntropy(agent.GetGenome().traits.inst_entropy);
+    phen.SetSimilarityThreshold(agent.GetSimilarityThreshold());
+    phen.SetTimeAllTasksCredited(tasks.GetAllTasksCreditedTime());
+    phen.SetUniqueTasksCompleted(tasks.GetUniqueTasksCompleted());
+    phen.SetUniqueTasksCredited(tasks.GetUniqueTasksCredited());
+    phen.SetTotalWastedCompletions(tasks.GetTotalTasksWasted());
+    for (size_t taskID = 0; taskID < tasks.GetSize(); ++taskID) {
+      phen.SetCredited(taskID, tasks.GetTask(taskID).GetCreditedCnt());
+      phen.SetCompleted(taskID, tasks.GetTask(taskID).GetCompletionCnt());
+      phen.SetWastedCompletions(taskID, tasks.GetTask(taskID).GetWastedCompletionsCnt());
+    }
+    phen.SetScore(calc_score(ctx, agent));
+  }
+
+  /// Decode program for the lockstep hardware. Returns false if the program can't run on it.
+  bool DecodeProgram(const packed_program_t & prog, batch_program_t & out, bool fuse=true) {
+    out.Clear();
+    bool ok = true;
+    prog.ForEachFunction([this, &out, &ok](size_t fID, uint32_t tag, const uint64_t * insts, size_t len) {
+      if (!ok || !out.PushFunction(tag)) { ok = false; return; }
+      for (size_t i = 0; i < len; ++i) {
+        const size_t id = packed_program_t::GetInstID(insts[i]);
+        if (id >= lockstep_opcodes.size() || lockstep_opcodes[id] < 0) { ok = false; return; }
+        if (!out.PushInst((uint8_t)lockstep_opcodes[id], packed_program_t::GetArg(insts[i], 0),
+                          packed_program_t::GetArg(insts[i], 1), packed_program_t::GetArg(insts[i], 2),
+                          packed_program_t::GetTag(insts[i]), lockstep_imms[id])) { ok = false; return; }
+      }
+    });
+    if (!ok) return false;
+    out.Finalize(fuse);
+    return true;
+  }
+
+  /// Can the given program be packed (see PackedProgram)?
+  bool CanPackProgram(const program_t & prog) const {
+    for (size_t fID = 0; fID < prog.GetSize(); ++fID) {
+      for (size_t i = 0; i < prog[fID].GetSize(); ++i) {
+        const inst_t & inst = prog[fID][i];
+        if (inst.id > packed_program_t::MAX_INST_ID) return false;
+        for (size_t k = 0; k < 3; ++k) {
+          if (inst.args[k] < 0 || inst.args[k] > packed_program_t::MAX_ARG) return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  /// Pack the given program (which must be packable) into the program arena.
+  ///  - Serial only (shares a pack buffer, and the arena isn't thread-safe).
+  std::shared_ptr<const packed_program_t> PackProgram(const program_t & prog) {
+    FillPackBuffer(prog, pack_buffer);
+    return std::make_shared<const packed_program_t>(emp::Ptr<packed_arena_t>(&program_arena), pack_buffer.data(),
+                                                    pack_buffer.size(), prog.GetSize());
+  }
+
+  /// Unpacked copy of the given program for a genome to keep (nullptr if genomes don't keep one).
+  std::shared_ptr<const program_t> KeepUnpacked(const program_t & prog) const {
+    return (KeepUnpackedPrograms()) ? std::make_shared<const program_t>(prog) : nullptr;
+  }
+
+  /// Pack the given program's (which must be packable) words into buffer.
+  void FillPackBuffer(const program_t & prog, emp::vector<uint64_t> & buffer) const {
+    emp_assert(CanPackProgram(prog));
+    buffer.clear();
+    for (size_t fID = 0; fID < prog.GetSize(); ++fID) {
+      const function_t & fun = prog[fID];
+      buffer.emplace_back(packed_program_t::PackFunctionHeader(fun.GetSize(), fun.affinity.GetUInt(0)));
+      for (size_t i = 0; i < fun.GetSize(); ++i) {
+        const inst_t & inst = fun[i];
+        buffer.emplace_back(packed_program_t::PackInst(inst.id, inst.args[0], inst.args[1], inst.args[2],
+                                                       inst.affinity.GetUInt(0)));
+      }
     }
   }
 
-  /// Evaluate given agent.
-  void Evaluate(agent_t & agent) {
-    begin_agent_eval_sig.Trigger(agent);
-    for (trial_id = 0; trial_id < TRIAL_CNT; ++trial_id) {
-      begin_agent_trial_sig.Trigger(agent);
-      do_agent_trial_sig.Trigger(agent);
-      end_agent_trial_sig.Trigger(agent);
+  /// Unpack a packed program into an EventDrivenGP program.
+  void UnpackProgram(const packed_program_t & prog, program_t & out) const {
+    out.Clear();
+    prog.ForEachFunction([&out](size_t fID, uint32_t tag, const uint64_t * insts, size_t len) {
+      function_t fun;
+      fun.affinity.SetUInt(0, tag);
+      for (size_t i = 0; i < len; ++i) {
+        tag_t inst_tag;
+        inst_tag.SetUInt(0, packed_program_t::GetTag(insts[i]));
+        fun.PushInst(packed_program_t::GetInstID(insts[i]), packed_program_t::GetArg(insts[i], 0),
+                     packed_program_t::GetArg(insts[i], 1), packed_program_t::GetArg(insts[i], 2), inst_tag);
+      }
+      out.PushFunction(fun);
+    });
+  }
+
+  /// Bytes the given program would take up unpacked (lower bound: ignores allocator overhead and spare capacity).
+  size_t GetUnpackedProgramBytes(const packed_program_t & prog) const {
+    return sizeof(program_t) + prog.GetSize() * sizeof(function_t) + prog.GetInstCnt() * sizeof(inst_t);
+  }
+
+  /// Are agents evaluated on lockstep (flat register file) hardware?
+  bool UseLockstepHardware() const { return EVAL_BATCH_SIZE > 1 || EVAL_FLAT_HARDWARE; }
+
+  /// Do genomes keep an unpacked copy of their program (see Genome::unpacked)?
+  ///  - Yes whenever something still works on unpacked programs: EventDrivenGP evaluation (SetProgram) or per-site
+  ///    mutation (SignalGPMutator). Otherwise, everything reads the packed words and programs get unpacked on demand.
+  bool KeepUnpackedPrograms() const {
+    return !UseLockstepHardware() || SGP_MUT_SAMPLING_MODE != MUT_SAMPLING_MODE_ID__GEOMETRIC;
+  }
+
+  /// Is MAP-Elites run in batches, on a sparse archive (MAP_ELITES_BATCH_SIZE)?
+  bool UseSparseMapArchive() const { return RUN_MODE == RUN_ID__MAPE && MAP_ELITES_BATCH_SIZE; }
+
+  /// Heap allocations made by the process so far (0 if no counter was provided).
+  size_t GetHeapAllocCnt() const { return (heap_alloc_cnt_fun) ? heap_alloc_cnt_fun() : 0; }
+
+  /// Lanes per lockstep hardware.
+  size_t GetLockstepLanes() const { return emp::Max(EVAL_BATCH_SIZE, (size_t)1); }
+
+  /// Hash of every agent's genome, in world order.
+  uint64_t GetPopulationHash() const {
+    uint64_t hash = MixStreamKey(world->GetSize());
+    for (size_t id = 0; id < world->GetSize(); ++id) {
+      hash = MixStreamKey(hash ^ ((world->IsOccupied(id)) ? world->GetOrg(id).genome.GetHash() : 0));
     }
-    end_agent_eval_sig.Trigger(agent);
+    return hash;
+  }
+
+  /// Get the evaluation context that owns the given hardware.
+  eval_ctx_t & GetEvalContext(hardware_t & hw) {
+    return *eval_contexts[(size_t)hw.GetTrait(TRAIT_ID__EVAL_CTX)];
   }
 
   /// Scratch/test function.
@@ -460,17 +1221,19 @@ protected:
 
 public:
   Experiment(const L9ChgEnvConfig & config)
-    : mutator(),
-      input_load_id(0),
+    : mutator(), mut_contexts(), next_gen(), repro_fitness(), repro_order(), map_axes(), map_archive(), map_capacity(0),
       update(0),
-      trial_id(0),
-      trial_time(0),
-      env_state(0),
+      update_eval_cnt(0), eval_ids(), eval_rep_ids(), genome_reps(),
+      lockstep_fuse(true), lockstep_on(true),
+      stream_seed(0),
       max_pop_size(0),
       dom_agent_id(0),
       best_score(0),
       max_inst_entropy(0),
-      phen_cache(0,0)
+      phen_cache(0,0),
+      scratch_program(nullptr),
+      offspring_time(0), snapshot_time(0),
+      trial_runner(nullptr)
   {
     // Localize configs!
     // == DEFAULT_GROUP ==
@@ -485,6 +1248,13 @@ public:
     TRIAL_CNT = config.TRIAL_CNT(); 
     TASKS_ON = config.TASKS_ON(); 
     EVOLVE_SIMILARITY_THRESH = config.EVOLVE_SIMILARITY_THRESH();
+    EVAL_THREADS = config.EVAL_THREADS();
+    EVAL_RNG_MODE = config.EVAL_RNG_MODE();
+    EVAL_BATCH_SIZE = config.EVAL_BATCH_SIZE();
+    EVAL_DEDUPLICATE = config.EVAL_DEDUPLICATE();
+    EVAL_IDLE_FAST_FORWARD = config.EVAL_IDLE_FAST_FORWARD();
+    EVAL_SIGNAL_HOOKS = config.EVAL_SIGNAL_HOOKS();
+    EVAL_FLAT_HARDWARE = config.EVAL_FLAT_HARDWARE();
     // == ENVIRONMENT_GROUP ==
     ENVIRONMENT_STATES = config.ENVIRONMENT_STATES(); 
     ENVIRONMENT_TAG_GENERATION_METHOD = config.ENVIRONMENT_TAG_GENERATION_METHOD(); 
@@ -495,16 +1265,19 @@ public:
     ENVIRONMENT_DISTRACTION_SIGNALS = config.ENVIRONMENT_DISTRACTION_SIGNALS(); 
     ENVIRONMENT_DISTRACTION_SIGNAL_CNT = config.ENVIRONMENT_DISTRACTION_SIGNAL_CNT();
     ENVIRONMENT_DISTRACTION_SIGNAL_PROB = config.ENVIRONMENT_DISTRACTION_SIGNAL_PROB();
+    ENVIRONMENT_COMMON_SCHEDULES = config.ENVIRONMENT_COMMON_SCHEDULES();
     // == SELECTION_GROUP ==
     TOURNAMENT_SIZE = config.TOURNAMENT_SIZE(); 
     SELECTION_METHOD = config.SELECTION_METHOD(); 
     ELITE_SELECT__ELITE_CNT = config.ELITE_SELECT__ELITE_CNT(); 
+    REPRODUCTION_THREADS = config.REPRODUCTION_THREADS();
     MAP_ELITES_AXIS__INST_ENTROPY = config.MAP_ELITES_AXIS__INST_ENTROPY(); 
     MAP_ELITES_AXIS__FUNCTIONS_USED = config.MAP_ELITES_AXIS__FUNCTIONS_USED(); 
     MAP_ELITES_AXIS__FUNCTION_CNT = config.MAP_ELITES_AXIS__FUNCTION_CNT();
     MAP_ELITES_AXIS__SIMILARITY_THRESH = config.MAP_ELITES_AXIS__SIMILARITY_THRESH(); 
     MAP_ELITES_AXIS_RES__INST_ENTROPY = config.MAP_ELITES_AXIS_RES__INST_ENTROPY(); 
     MAP_ELITES_AXIS_RES__SIMILARITY_THRESH = config.MAP_ELITES_AXIS_RES__SIMILARITY_THRESH(); 
+    MAP_ELITES_BATCH_SIZE = config.MAP_ELITES_BATCH_SIZE();
     // == SGP_PROGRAM_GROUP ==
     SGP_PROG_MAX_FUNC_CNT = config.SGP_PROG_MAX_FUNC_CNT(); 
     SGP_PROG_MIN_FUNC_CNT = config.SGP_PROG_MIN_FUNC_CNT(); 
@@ -528,6 +1301,7 @@ public:
     SGP_MUT_PER_FUNC__SLIP_RATE = config.SGP_MUT_PER_FUNC__SLIP_RATE(); 
     SGP_MUT_PER_FUNC__FUNC_DUP_RATE = config.SGP_MUT_PER_FUNC__FUNC_DUP_RATE(); 
     SGP_MUT_PER_FUNC__FUNC_DEL_RATE = config.SGP_MUT_PER_FUNC__FUNC_DEL_RATE(); 
+    SGP_MUT_SAMPLING_MODE = config.SGP_MUT_SAMPLING_MODE();
     // == DATA_GROUP ==
     SYSTEMATICS_INTERVAL = config.SYSTEMATICS_INTERVAL(); 
     FITNESS_INTERVAL = config.FITNESS_INTERVAL(); 
@@ -541,6 +1315,7 @@ public:
 
     // Create a new random number generator
     random = emp::NewPtr<emp::Random>(RANDOM_SEED);
+    stream_seed = random->GetSeed();
 
     // Make the world!
     world = emp::NewPtr<world_t>(*random, "World");
@@ -554,6 +1329,21 @@ public:
       exit(-1);
     }
 
+    if (SGP_PROG_MAX_FUNC_CNT > MAX_FUNC_CNT) {
+      std::cout << "Cannot run experiment with SGP_PROG_MAX_FUNC_CNT > " << MAX_FUNC_CNT << ". Exiting..." << std::endl;
+      exit(-1);
+    }
+
+    if (SGP_MUT_SAMPLING_MODE != MUT_SAMPLING_MODE_ID__PER_SITE && SGP_MUT_SAMPLING_MODE != MUT_SAMPLING_MODE_ID__GEOMETRIC) {
+      std::cout << "Unrecognized mutation sampling mode (" << SGP_MUT_SAMPLING_MODE << "). Exiting..." << std::endl;
+      exit(-1);
+    }
+
+    if (SGP_MUT_PROG_MAX_ARG_VAL < 0 || SGP_MUT_PROG_MAX_ARG_VAL > packed_program_t::MAX_ARG) {
+      std::cout << "Cannot run experiment with SGP_MUT_PROG_MAX_ARG_VAL outside [0, " << packed_program_t::MAX_ARG << "] (packed programs). Exiting..." << std::endl;
+      exit(-1);
+    }
+
     // Configure the environment tags.
     switch(ENVIRONMENT_TAG_GENERATION_METHOD) {
       case ENV_TAG_GEN_ID__RANDOM: {
@@ -585,14 +1375,10 @@ public:
       std::cout << std::endl;
     }
 
-    // Populate environment shuffler!
-    for (size_t i = 0; i < env_state_tags.size(); ++i) env_shuffler.emplace_back(i);
-    env_shuffle_id = 0;
-
-    // Make empty instruction/event libraries. Make hardware.
+    // Make empty instruction/event libraries.
     inst_lib = emp::NewPtr<inst_lib_t>();
+    scratch_program = emp::NewPtr<program_t>(inst_lib);
     event_lib = emp::NewPtr<event_lib_t>();
-    eval_hw = emp::NewPtr<hardware_t>(inst_lib, event_lib, random);
 
     // Configure the mutator
     mutator.SetProgMinFuncCnt(SGP_PROG_MIN_FUNC_CNT);
@@ -608,10 +1394,25 @@ public:
     mutator.SetPerFuncSlipRate(SGP_MUT_PER_FUNC__SLIP_RATE);
     mutator.SetPerFuncDupRate(SGP_MUT_PER_FUNC__FUNC_DUP_RATE);
     mutator.SetPerFuncDelRate(SGP_MUT_PER_FUNC__FUNC_DEL_RATE);
+    packed_mutator.SetProgMinFuncCnt(SGP_PROG_MIN_FUNC_CNT);
+    packed_mutator.SetProgMaxFuncCnt(SGP_PROG_MAX_FUNC_CNT);
+    packed_mutator.SetProgMinFuncLen(SGP_PROG_MIN_FUNC_LEN);
+    packed_mutator.SetProgMaxFuncLen(SGP_PROG_MAX_FUNC_LEN);
+    packed_mutator.SetProgMaxTotalLen(SGP_PROG_MAX_TOTAL_LEN);
+    packed_mutator.SetProgMaxArgVal(SGP_MUT_PROG_MAX_ARG_VAL);
+    packed_mutator.SetPerBitTagBitFlipRate(SGP_MUT_PER_BIT__TAG_BFLIP_RATE);
+    packed_mutator.SetPerInstSubRate(SGP_MUT_PER_INST__SUB_RATE);
+    packed_mutator.SetPerInstInsRate(SGP_MUT_PER_INST__INS_RATE);
+    packed_mutator.SetPerInstDelRate(SGP_MUT_PER_INST__DEL_RATE);
+    packed_mutator.SetPerFuncSlipRate(SGP_MUT_PER_FUNC__SLIP_RATE);
+    packed_mutator.SetPerFuncDupRate(SGP_MUT_PER_FUNC__FUNC_DUP_RATE);
+    packed_mutator.SetPerFuncDelRate(SGP_MUT_PER_FUNC__FUNC_DEL_RATE);
 
     // Configure hardware, etc
     DoConfig__Tasks();
+    InitEvalContexts();
     DoConfig__Hardware();
+    InitMutationContexts();
 
     switch (RUN_MODE) {
       case RUN_ID__EVO: {
@@ -638,21 +1439,54 @@ public:
   }
 
   ~Experiment() {
-    eval_hw.Delete();
+    for (size_t i = 0; i < eval_contexts.size(); ++i) {
+      for (size_t k = 0; k < eval_contexts[i]->batch_randoms.size(); ++k) eval_contexts[i]->batch_randoms[k].Delete();
+      if (eval_contexts[i]->batch_hw) eval_contexts[i]->batch_hw.Delete();
+      eval_contexts[i]->hw.Delete();
+      eval_contexts[i]->program.Delete();
+      if (eval_contexts[i]->owns_random) eval_contexts[i]->random.Delete();
+      eval_contexts[i]->snapshot_random.Delete();
+      eval_contexts[i].Delete();
+    }
+    scratch_program.Delete();
+    world.Delete();
+    // Mutation contexts own arenas: release every program that might live in one first.
+    next_gen.clear();
+    map_offspring.clear();
+    for (size_t i = 0; i < mut_contexts.size(); ++i) mut_contexts[i].Delete();
     event_lib.Delete();
     inst_lib.Delete();
-    world.Delete();
     random.Delete();
   }
 
   // === Run functions ===
   void Run();
+
+  /// Give analyses a way to count heap allocations (fun returns the number made by the process so far).
+  void SetHeapAllocCounter(const std::function<size_t()> & fun) { heap_alloc_cnt_fun = fun; }
   void RunStep();
 
   // === Evolution functions ===
   double GetFitness(agent_t & agent);
+  void EvaluatePopulation();
+  size_t EvaluateRange(eval_ctx_t & ctx, const emp::vector<size_t> & ids, size_t begin, size_t end);
+  void EvaluateBatch(eval_ctx_t & ctx, size_t lanes);
+  void RunBatchTrial(eval_ctx_t & ctx, size_t lanes, const env_schedule_t & sched);
+  void EvaluateSnapshotTrials(eval_ctx_t & ctx, agent_t & agent, size_t stream_agent_id, size_t first_trial,
+                              size_t trial_cnt, double * scores, size_t * funcs_used, uint32_t * call_cnts=nullptr);
+  void EvaluateSnapshots(size_t trial_cnt, bool count_calls=false);
 
   size_t MutateSimilarityThresh(agent_t & agent, emp::Random & rnd);
+  size_t MutateProgram(genome_t & genome, emp::Random & rnd, mut_ctx_t & mctx);
+  size_t MutateAgent(agent_t & agent, emp::Random & rnd, mut_ctx_t & mctx);
+  void Reproduce();
+  void InstallNextGeneration();
+  void EvaluateAgents(const emp::vector<emp::Ptr<agent_t>> & agents, const emp::vector<size_t> & stream_ids);
+  uint64_t GetMapCell(agent_t & agent);
+  size_t ReserveMapSlots(size_t batch_size);
+  void DoMapElitesBatch(size_t batch_size);
+  void ArchiveMapOffspring(size_t batch_size);
+  void InjectGenome(const genome_t & genome, size_t copies);
 
   // === Config functions ===
   void DoConfig__Hardware();
@@ -663,7 +1497,16 @@ public:
   void DoConfig__Experiment(); ///< Setup experiment
   void DoConfig__Analysis();   ///< Setup analysis
 
+  // === Analysis functions ===
+  /// Compare agent-timesteps/sec of EventDrivenGP and lockstep hardware on the same population
+  void Analysis__EvalBenchmark();
+  void Analysis__DispatchBenchmark();
+  void Analysis__LockstepEquivalence();
+  void Analysis__HardwareTrajectory();
+
   // === Utility functions ===
+  void InitEvalContexts();
+  void InitMutationContexts();
   void SaveEnvTags();
   void GenerateEnvTags__FromTagFile();
 
@@ -685,7 +1528,8 @@ public:
 
   // === Extra SignalGP instruction definitions ===
   // -- Execution control instructions --
-  static void Inst_Fork(hardware_t & hw, const inst_t & inst);      
+  void Inst_Call(hardware_t & hw, const inst_t & inst);
+  void Inst_Fork(hardware_t & hw, const inst_t & inst);      
   static void Inst_Terminate(hardware_t & hw, const inst_t & inst); 
   static void Inst_Nand(hardware_t & hw, const inst_t & inst);
 
@@ -694,7 +1538,7 @@ public:
   void Inst_Submit(hardware_t & hw, const inst_t & inst);
 
   // === SignalGP event definitions ===
-  static void HandleEvent__EnvSignal_ED(hardware_t & hw, const event_t & event);
+  void HandleEvent__EnvSignal_ED(hardware_t & hw, const event_t & event);
   static void HandleEvent__EnvSignal_IMP(hardware_t & hw, const event_t & event);
   static void DispatchEvent__EnvSignal_ED(hardware_t & hw, const event_t & event);
   static void DispatchEvent__EnvSignal_IMP(hardware_t & hw, const event_t & event);
@@ -702,9 +1546,17 @@ public:
 };
 
 // == Extra SignalGP instructions ==
+/// Same as EventDrivenGP::Inst_Call, but records function usage inline.
+void Experiment::Inst_Call(hardware_t & hw, const inst_t & inst) {
+  const size_t fID = FindBestFunction(hw, inst.affinity, hw.GetMinBindThresh());
+  if (fID == (size_t)-1) return;
+  if (hw.GetCurCore().size() < hw.GetMaxCallDepth()) GetEvalContext(hw).functions_used.Mark(fID);
+  hw.CallFunction(fID);
+}
+
 void Experiment::Inst_Fork(hardware_t & hw, const inst_t & inst) {
   state_t & state = hw.GetCurState();
-  hw.SpawnCore(inst.affinity, hw.GetMinBindThresh(), state.local_mem, false);
+  SpawnMatchedCore(hw, inst.affinity, hw.GetMinBindThresh(), state.local_mem);
 }
 
 void Experiment::Inst_Terminate(hardware_t & hw, const inst_t & inst)  {
@@ -721,29 +1573,32 @@ void Experiment::Inst_Nand(hardware_t & hw, const inst_t & inst) {
 }
 
 void Experiment::Inst_Load1(hardware_t & hw, const inst_t & inst) {
+  eval_ctx_t & ctx = GetEvalContext(hw);
   state_t & state = hw.GetCurState();
-  state.SetLocal(inst.args[0], task_inputs[input_load_id]); // Load input.
-  input_load_id += 1;
-  if (input_load_id >= task_inputs.size()) input_load_id = 0; // Update load ID.
+  state.SetLocal(inst.args[0], ctx.task_inputs[ctx.input_load_id]); // Load input.
+  ctx.input_load_id += 1;
+  if (ctx.input_load_id >= ctx.task_inputs.size()) ctx.input_load_id = 0; // Update load ID.
 }
 
 void Experiment::Inst_Load2(hardware_t & hw, const inst_t & inst) {
+  eval_ctx_t & ctx = GetEvalContext(hw);
   state_t & state = hw.GetCurState();
-  state.SetLocal(inst.args[0], task_inputs[0]);
-  state.SetLocal(inst.args[1], task_inputs[1]);
+  state.SetLocal(inst.args[0], ctx.task_inputs[0]);
+  state.SetLocal(inst.args[1], ctx.task_inputs[1]);
 }
 
 void Experiment::Inst_Submit(hardware_t & hw, const inst_t & inst) {
+  eval_ctx_t & ctx = GetEvalContext(hw);
   state_t & state = hw.GetCurState();
   // Credit?
-  const bool credit = hw.GetTrait(TRAIT_ID__STATE) == env_state;
+  const bool credit = hw.GetTrait(TRAIT_ID__STATE) == ctx.env_state;
   // Submit!
-  task_set.Submit((task_io_t)state.GetLocal(inst.args[0]), trial_time, credit);
+  ctx.task_set.Submit((task_io_t)state.GetLocal(inst.args[0]), ctx.trial_time, credit);
 }
 
 // === SignalGP events ===
 // Events.
-void Experiment::HandleEvent__EnvSignal_ED(hardware_t & hw, const event_t & event) { hw.SpawnCore(event.affinity, hw.GetMinBindThresh(), event.msg); }
+void Experiment::HandleEvent__EnvSignal_ED(hardware_t & hw, const event_t & event) { SpawnMatchedCore(hw, event.affinity, hw.GetMinBindThresh(), event.msg); }
 void Experiment::HandleEvent__EnvSignal_IMP(hardware_t & hw, const event_t & event) { return; }
 void Experiment::DispatchEvent__EnvSignal_ED(hardware_t & hw, const event_t & event) { hw.QueueEvent(event); }
 void Experiment::DispatchEvent__EnvSignal_IMP(hardware_t & hw, const event_t & event) { return; }
@@ -773,8 +1628,39 @@ void Experiment::Run() {
 
 void Experiment::RunStep() {
   do_evaluation_sig.Trigger();
+  // Selection and world update are where offspring get created; report what that costs.
+  for (size_t i = 0; i < mut_contexts.size(); ++i) mut_contexts[i]->ResetCounts();
+  snapshot_time = 0;
+  const auto offspring_start = std::chrono::steady_clock::now();
   do_selection_sig.Trigger();
   do_world_update_sig.Trigger();
+  offspring_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - offspring_start).count();
+  offspring_time -= snapshot_time;
+  size_t offspring_cnt = 0;
+  size_t offspring_copy_cnt = 0;
+  size_t offspring_unchanged_cnt = 0;
+  for (size_t i = 0; i < mut_contexts.size(); ++i) {
+    offspring_cnt += mut_contexts[i]->offspring_cnt;
+    offspring_copy_cnt += mut_contexts[i]->copy_cnt;
+    offspring_unchanged_cnt += mut_contexts[i]->unchanged_cnt;
+  }
+  std::cout << "  Offspring: " << offspring_cnt << " Program copies: " << offspring_copy_cnt
+            << " Shared programs: " << offspring_cnt - offspring_copy_cnt
+            << " (" << offspring_unchanged_cnt << " mutated back to parent's)"
+            << " Offspring cost: " << offspring_time << " ms";
+  if (offspring_cnt) std::cout << " (" << (1000.0 * offspring_time) / offspring_cnt << " us/offspring)";
+  std::cout << std::endl;
+  // Program memory (shared programs only count once in the arena).
+  if (world->GetNumOrgs()) {
+    size_t unpacked_bytes = 0;
+    for (size_t id = 0; id < world->GetSize(); ++id) {
+      if (world->IsOccupied(id)) unpacked_bytes += GetUnpackedProgramBytes(world->GetOrg(id).GetProgram());
+    }
+    std::cout << "  Program bytes/agent: " << (double)program_arena.GetLiveBytes() / world->GetNumOrgs()
+              << " packed (arena reserved: " << program_arena.GetReservedBytes() << " bytes),"
+              << " unpacked" << ((KeepUnpackedPrograms()) ? " (kept with genomes): " : " (not kept): ")
+              << (double)unpacked_bytes / world->GetNumOrgs() << std::endl;
+  }
 }
 
 // === Evolution functions ===
@@ -783,6 +1669,577 @@ double Experiment::GetFitness(agent_t & agent) {
   return phen_cache.GetRepresentativePhen(aID).GetScore();
 }
 
+/// Evaluate every agent in the world.
+///  - With EVAL_DEDUPLICATE, only the first agent with each distinct genome gets evaluated; every duplicate
+///    gets a copy of its phenotypes.
+///  - Agents to evaluate are split into contiguous chunks, one per evaluation context.
+///  - Each chunk is evaluated on its own thread; agents only write to their own phenotype cache slots.
+void Experiment::EvaluatePopulation() {
+  const size_t pop_size = world->GetSize();
+  eval_ids.clear();
+  eval_rep_ids.resize(pop_size);
+  genome_reps.clear();
+  for (size_t id = 0; id < pop_size; ++id) {
+    agent_t & agent = world->GetOrg(id);
+    agent.SetID(id);
+    eval_rep_ids[id] = id;
+    if (EVAL_DEDUPLICATE) {
+      const uint64_t hash = agent.GetGenome().GetHash();
+      auto rep_it = genome_reps.find(hash);
+      if (rep_it == genome_reps.end()) {
+        genome_reps.emplace(hash, id);
+      } else if (world->GetOrg(rep_it->second).GetGenome() == agent.GetGenome()) {
+        eval_rep_ids[id] = rep_it->second;
+        continue;
+      }
+    }
+    eval_ids.emplace_back(id);
+  }
+
+  const size_t eval_cnt = eval_ids.size();
+  const size_t worker_cnt = emp::Max((size_t)1, emp::Min(eval_contexts.size(), eval_cnt));
+  const size_t chunk_size = (eval_cnt + worker_cnt - 1) / worker_cnt;
+
+  auto evaluate_chunk = [this, eval_cnt, chunk_size](size_t worker_id) {
+    const size_t begin = worker_id * chunk_size;
+    const size_t end = emp::Min(begin + chunk_size, eval_cnt);
+    this->EvaluateRange(*eval_contexts[worker_id], eval_ids, begin, end);
+  };
+
+  if (worker_cnt == 1 || !WORKER_THREADS) {
+    for (size_t worker_id = 0; worker_id < worker_cnt; ++worker_id) evaluate_chunk(worker_id);
+  } else {
+    emp::vector<std::thread> workers;
+    for (size_t worker_id = 0; worker_id < worker_cnt; ++worker_id) {
+      workers.emplace_back(evaluate_chunk, worker_id);
+    }
+    for (size_t worker_id = 0; worker_id < worker_cnt; ++worker_id) {
+      workers[worker_id].join();
+    }
+  }
+
+  // Fan results out to duplicates.
+  if (eval_cnt == pop_size) return;
+  for (size_t id = 0; id < pop_size; ++id) {
+    if (eval_rep_ids[id] != id) phen_cache.CopyAgent(eval_rep_ids[id], id);
+  }
+}
+
+/// Evaluate agents ids[begin, end) of the world using the given evaluation context.
+///  - With lockstep hardware, agents are evaluated EVAL_BATCH_SIZE at a time. Agents whose programs can't run
+///    on lockstep hardware fall back to EventDrivenGP hardware.
+///  - Returns the number of agents evaluated on lockstep hardware.
+size_t Experiment::EvaluateRange(eval_ctx_t & ctx, const emp::vector<size_t> & ids, size_t begin, size_t end) {
+  size_t lanes = 0;
+  size_t lockstep_cnt = 0;
+  for (size_t i = begin; i < end; ++i) {
+    const size_t id = ids[i];
+    agent_t & our_hero = world->GetOrg(id);
+    our_hero.SetID(id);
+    if (!ctx.batch_hw || !lockstep_on || !DecodeProgram(our_hero.GetProgram(), ctx.batch_programs[lanes], lockstep_fuse)) {
+      Evaluate(ctx, our_hero);
+      continue;
+    }
+    ctx.batch_agents[lanes] = &our_hero;
+    ctx.batch_ids[lanes++] = id;
+    if (lanes == ctx.batch_ids.size()) {
+      EvaluateBatch(ctx, lanes);
+      lockstep_cnt += lanes;
+      lanes = 0;
+    }
+  }
+  if (lanes) {
+    EvaluateBatch(ctx, lanes);
+    lockstep_cnt += lanes;
+  }
+  return lockstep_cnt;
+}
+
+/// Evaluate the agents loaded into the first lanes lanes of the context's lockstep hardware.
+///  - Every trial replays this update's common environment schedule; all lanes advance one timestep at a time.
+///  - Equivalent to Evaluate (per agent), except that agent evaluation/trial signals are not triggered.
+void Experiment::EvaluateBatch(eval_ctx_t & ctx, size_t lanes) {
+  batch_hw_t & hw = *ctx.batch_hw;
+  const bool lane_streams = (EVAL_RNG_MODE == EVAL_RNG_MODE_ID__TRIAL_STREAMS);
+  for (size_t lane = 0; lane < lanes; ++lane) {
+    agent_t & agent = *ctx.batch_agents[lane];
+    const double thresh = (EVOLVE_SIMILARITY_THRESH) ? agent.GetSimilarityThreshold() : SGP_HW_MIN_BIND_THRESH;
+    if (!agent.GetGenome().IsPrepared()) PrepareGenome(agent.GetGenome());
+    hw.SetLane(lane, &ctx.batch_programs[lane], &agent.GetGenome().env_bindings, thresh,
+               (lane_streams) ? ctx.batch_randoms[lane] : ctx.random, &ctx.batch_task_sets[lane]);
+  }
+  for (ctx.trial_id = 0; ctx.trial_id < TRIAL_CNT; ++ctx.trial_id) {
+    if (lane_streams) {
+      for (size_t lane = 0; lane < lanes; ++lane) {
+        ctx.batch_randoms[lane]->ResetSeed(GetStreamSeed(stream_seed, update, ctx.batch_ids[lane], ctx.trial_id));
+      }
+    }
+    RunBatchTrial(ctx, lanes, env_schedules[ctx.trial_id]);
+  }
+  for (size_t lane = 0; lane < lanes; ++lane) phen_cache.SetRepresentativeEval(ctx.batch_ids[lane]);
+}
+
+/// Run a single trial (ctx.trial_id) on the first lanes lanes of the context's lockstep hardware, replaying the
+/// given environment schedule, and record it.
+///  - Lanes must already be loaded (programs, bindings, random number generators); every lane starts from the
+///    hardware's blank reset image.
+void Experiment::RunBatchTrial(eval_ctx_t & ctx, size_t lanes, const env_schedule_t & sched) {
+  batch_hw_t & hw = *ctx.batch_hw;
+  // Reset lanes.
+  hw.SetTaskInputs(sched.task_inputs);
+  for (size_t lane = 0; lane < lanes; ++lane) {
+    ctx.batch_task_sets[lane].SetSolutions(sched.task_solutions.data());
+    hw.ResetLane(lane);
+    phen_cache.Get(ctx.batch_ids[lane], ctx.trial_id).Reset();
+  }
+  // Run trial.
+  size_t env_state = (size_t)-1;
+  size_t event_id = 0;
+  for (size_t t = 0; t < EVAL_TIME; ++t) {
+    // 1) Advance environment.
+    while (event_id < sched.events.size() && sched.events[event_id].time == t) {
+      const env_schedule_t::Event & event = sched.events[event_id];
+      if (event.is_distraction) {
+        if (SGP_ENVIRONMENT_SIGNALS) hw.QueueSignal(GetDistractionTagID(event.tag_id));
+      } else {
+        env_state = event.tag_id;
+        if (SGP_ENVIRONMENT_SIGNALS) hw.QueueSignal(env_state);
+      }
+      ++event_id;
+    }
+    hw.SetEnvironment(env_state, t);
+    // 2) Advance agents.
+    hw.Step(lanes);
+    for (size_t lane = 0; lane < lanes; ++lane) {
+      if (hw.IsInState(lane, env_state)) phen_cache.Get(ctx.batch_ids[lane], ctx.trial_id).IncEnvMatchScore();
+    }
+    // 3) If every lane is idle, skip ahead to the next environment event.
+    if (!EVAL_IDLE_FAST_FORWARD || !hw.IsIdle(lanes)) continue;
+    const size_t next_time = (event_id < sched.events.size()) ? emp::Min(sched.events[event_id].time, EVAL_TIME) : EVAL_TIME;
+    const size_t skipped = next_time - t - 1;
+    if (skipped) {
+      for (size_t lane = 0; lane < lanes; ++lane) {
+        if (hw.IsInState(lane, env_state)) phen_cache.Get(ctx.batch_ids[lane], ctx.trial_id).IncEnvMatchScore(skipped);
+      }
+    }
+    t = next_time - 1;
+  }
+  // Record trial.
+  for (size_t lane = 0; lane < lanes; ++lane) {
+    RecordTrial(ctx, *ctx.batch_agents[lane], ctx.batch_task_sets[lane], hw.GetFunctionsUsed(lane));
+  }
+}
+
+/// Evaluate the given agent for extra (snapshot) trials [first_trial, first_trial + trial_cnt), recording every
+/// trial's score and functions used in scores[i] and funcs_used[i].
+///  - If call_cnts isn't null, every function's calls over these trials get added to call_cnts (MAX_FUNC_CNT entries).
+///  - Snapshot trial t gets a freshly generated environment schedule and its own random number stream, keyed by
+///    (stream_agent_id, TRIAL_CNT + t), which regular evaluation never uses. A trial's outcome therefore doesn't
+///    depend on how an agent's snapshot trials get split up.
+///  - Trials draw from the context's snapshot generator only: evaluation generators (with EVAL_RNG_MODE=0, context
+///    0's is the experiment's own) are left alone.
+///  - With lockstep hardware, the agent's program is decoded and loaded once and every trial starts from the
+///    hardware's blank reset image. Otherwise, trials run on EventDrivenGP hardware.
+///  - Overwrites the agent's phenotype for trial 0.
+void Experiment::EvaluateSnapshotTrials(eval_ctx_t & ctx, agent_t & agent, size_t stream_agent_id, size_t first_trial,
+                                        size_t trial_cnt, double * scores, size_t * funcs_used, uint32_t * call_cnts) {
+  ctx.stream_agent_id = stream_agent_id;
+  if (ctx.batch_hw && lockstep_on && DecodeProgram(agent.GetProgram(), ctx.batch_programs[0], lockstep_fuse)) {
+    batch_hw_t & hw = *ctx.batch_hw;
+    emp::Ptr<emp::Random> rnd = ctx.snapshot_random;
+    if (!agent.GetGenome().IsPrepared()) PrepareGenome(agent.GetGenome());
+    const double thresh = (EVOLVE_SIMILARITY_THRESH) ? agent.GetSimilarityThreshold() : SGP_HW_MIN_BIND_THRESH;
+    hw.SetLane(0, &ctx.batch_programs[0], &agent.GetGenome().env_bindings, thresh, rnd, &ctx.batch_task_sets[0]);
+    ctx.batch_agents[0] = &agent;
+    ctx.batch_ids[0] = agent.GetID();
+    ctx.trial_id = 0;
+    for (size_t i = 0; i < trial_cnt; ++i) {
+      ctx.stream_trial_id = TRIAL_CNT + first_trial + i; // Don't reuse the streams from regular evaluation.
+      rnd->ResetSeed(GetStreamSeed(stream_seed, update, ctx.stream_agent_id, ctx.stream_trial_id));
+      GenerateEnvSchedule(*rnd, ctx.scratch_schedule);
+      RunBatchTrial(ctx, 1, ctx.scratch_schedule);
+      scores[i] = phen_cache.Get(agent.GetID(), ctx.trial_id).GetScore();
+      funcs_used[i] = phen_cache.Get(agent.GetID(), ctx.trial_id).GetFunctionsUsed();
+      if (call_cnts) hw.GetFunctionUsage(0).AddCallCnts(call_cnts);
+    }
+    return;
+  }
+  // Every EventDrivenGP-path draw goes through ctx.random: point it at the snapshot generator for now.
+  const emp::Ptr<emp::Random> eval_random = ctx.random;
+  ctx.random = ctx.snapshot_random;
+  begin_agent_eval_sig.Trigger(ctx, agent);
+  for (size_t i = 0; i < trial_cnt; ++i) {
+    ctx.trial_id = 0;
+    ctx.stream_trial_id = TRIAL_CNT + first_trial + i; // Don't reuse the streams from regular evaluation.
+    ctx.random->ResetSeed(GetStreamSeed(stream_seed, update, ctx.stream_agent_id, ctx.stream_trial_id));
+    begin_agent_trial_sig.Trigger(ctx, agent);
+    do_agent_trial_sig.Trigger(ctx, agent);
+    end_agent_trial_sig.Trigger(ctx, agent);
+    scores[i] = phen_cache.Get(agent.GetID(), ctx.trial_id).GetScore();
+    funcs_used[i] = phen_cache.Get(agent.GetID(), ctx.trial_id).GetFunctionsUsed();
+    if (call_cnts) ctx.functions_used.AddCallCnts(call_cnts);
+  }
+  ctx.random = eval_random;
+}
+
+/// Snapshot evaluation engine: run trial_cnt snapshot trials (see EvaluateSnapshotTrials) for every agent in
+/// snapshot_agents, recording agent i's trial t in snapshot_scores/snapshot_funcs_used[i * trial_cnt + t].
+///  - (agent, SNAPSHOT_TRIAL_CHUNK_SIZE trials) work items are dealt round-robin to one worker per evaluation
+///    context, so even a single agent's trials get spread across threads.
+///  - Every worker evaluates copies of its agents in its own phenotype slot (past every population/archive slot),
+///    so snapshots leave agents' phenotypes alone.
+///  - Agent i's random number streams are keyed by snapshot_stream_ids[i], so results don't depend on EVAL_THREADS.
+///  - With count_calls, every agent's per-function call counts (summed over its trials) go into snapshot_call_cnts.
+///    Work items count into their own blocks, which get summed per agent once every worker is done.
+void Experiment::EvaluateSnapshots(size_t trial_cnt, bool count_calls) {
+  emp_assert(snapshot_agents.size() == snapshot_stream_ids.size());
+  const size_t agent_cnt = snapshot_agents.size();
+  snapshot_scores.resize(agent_cnt * trial_cnt);
+  snapshot_funcs_used.resize(agent_cnt * trial_cnt);
+  snapshot_call_cnts.clear();
+  if (!agent_cnt || !trial_cnt) return;
+  // Genomes get prepared here, once, rather than by every worker that evaluates a copy.
+  for (size_t i = 0; i < agent_cnt; ++i) {
+    if (!snapshot_agents[i]->GetGenome().IsPrepared()) PrepareGenome(snapshot_agents[i]->GetGenome());
+  }
+  const size_t chunk_cnt = (trial_cnt + SNAPSHOT_TRIAL_CHUNK_SIZE - 1) / SNAPSHOT_TRIAL_CHUNK_SIZE;
+  const size_t item_cnt = agent_cnt * chunk_cnt;
+  if (count_calls) snapshot_call_cnts.assign(item_cnt * MAX_FUNC_CNT, 0);
+  const size_t worker_cnt = emp::Max((size_t)1, emp::Min(eval_contexts.size(), item_cnt));
+  // Nothing else lives past the population's (archive's) slots while snapshots are taken.
+  const size_t slot_base = (UseSparseMapArchive()) ? map_capacity : max_pop_size;
+  phen_cache.Grow(slot_base + worker_cnt);
+
+  auto evaluate_items = [this, trial_cnt, chunk_cnt, item_cnt, worker_cnt, slot_base, count_calls](size_t worker_id) {
+    eval_ctx_t & ctx = *eval_contexts[worker_id];
+    agent_t agent(*snapshot_agents[0]);
+    for (size_t item = worker_id; item < item_cnt; item += worker_cnt) {
+      const size_t agent_id = item / chunk_cnt;
+      const size_t first_trial = (item % chunk_cnt) * SNAPSHOT_TRIAL_CHUNK_SIZE;
+      const size_t cnt = emp::Min(SNAPSHOT_TRIAL_CHUNK_SIZE, trial_cnt - first_trial);
+      agent = *snapshot_agents[agent_id];
+      agent.SetID(slot_base + worker_id);
+      const size_t result_id = agent_id * trial_cnt + first_trial;
+      uint32_t * call_cnts = (count_calls) ? snapshot_call_cnts.data() + item * MAX_FUNC_CNT : nullptr;
+      this->EvaluateSnapshotTrials(ctx, agent, snapshot_stream_ids[agent_id], first_trial, cnt,
+                                   snapshot_scores.data() + result_id, snapshot_funcs_used.data() + result_id, call_cnts);
+    }
+  };
+
+  if (worker_cnt == 1 || !WORKER_THREADS) {
+    for (size_t worker_id = 0; worker_id < worker_cnt; ++worker_id) evaluate_items(worker_id);
+  } else {
+    emp::vector<std::thread> workers;
+    for (size_t worker_id = 0; worker_id < worker_cnt; ++worker_id) {
+      workers.emplace_back(evaluate_items, worker_id);
+    }
+    for (size_t worker_id = 0; worker_id < worker_cnt; ++worker_id) {
+      workers[worker_id].join();
+    }
+  }
+
+  if (!count_calls) return;
+  // Sum every agent's items into its first item's block, then pack agents' blocks together.
+  for (size_t agent_id = 0; agent_id < agent_cnt; ++agent_id) {
+    uint32_t * total = snapshot_call_cnts.data() + agent_id * chunk_cnt * MAX_FUNC_CNT;
+    for (size_t chunk = 1; chunk < chunk_cnt; ++chunk) {
+      const uint32_t * cnts = total + chunk * MAX_FUNC_CNT;
+      for (size_t fID = 0; fID < MAX_FUNC_CNT; ++fID) total[fID] += cnts[fID];
+    }
+    std::copy_n(total, MAX_FUNC_CNT, snapshot_call_cnts.begin() + agent_id * MAX_FUNC_CNT);
+  }
+  snapshot_call_cnts.resize(agent_cnt * MAX_FUNC_CNT);
+}
+
+/// Apply program mutations to the given genome. Returns the number of mutations, or 0 if the program came out
+/// unchanged (e.g., every substitution redrew the old value), so callers can skip re-preparing the genome.
+///  - Per-site sampling: mutations get applied to a scratch copy of the genome's unpacked program (kept with the
+///    genome, see KeepUnpackedPrograms), which then gets packed.
+///  - Geometric sampling: mutations get applied straight to the packed program (see PackedMutator). The result only
+///    gets unpacked if genomes keep unpacked programs (EventDrivenGP evaluation).
+///  - The genome only gets new programs if something actually changed (otherwise it keeps sharing its parent's).
+///  - Thread-safe as long as every thread uses its own mutation context.
+size_t Experiment::MutateProgram(genome_t & genome, emp::Random & rnd, mut_ctx_t & mctx) {
+  ++mctx.offspring_cnt;
+  const packed_program_t & parent = genome.GetProgram();
+  size_t mut_cnt = 0;
+  size_t func_cnt = 0;
+  if (SGP_MUT_SAMPLING_MODE == MUT_SAMPLING_MODE_ID__GEOMETRIC) {
+    mut_cnt = mctx.packed_mutator.ApplyMutations(parent, rnd, mctx.pack_buffer, func_cnt);
+  } else {
+    if (genome.unpacked) *mctx.program = *genome.unpacked;
+    else UnpackProgram(parent, *mctx.program);
+    mut_cnt = mctx.mutator.ApplyMutations(*mctx.program, rnd);
+    if (mut_cnt) {
+      FillPackBuffer(*mctx.program, mctx.pack_buffer);
+      func_cnt = mctx.program->GetSize();
+    }
+  }
+  if (!mut_cnt) return 0;
+  if (parent.GetSize() == func_cnt && parent.Equals(mctx.pack_buffer.data(), mctx.pack_buffer.size())) {
+    ++mctx.unchanged_cnt;
+    return 0;
+  }
+  genome.program = std::make_shared<const packed_program_t>(mctx.arena, mctx.pack_buffer.data(),
+                                                            mctx.pack_buffer.size(), func_cnt);
+  if (!KeepUnpackedPrograms()) {
+    genome.unpacked = nullptr;
+  } else if (SGP_MUT_SAMPLING_MODE == MUT_SAMPLING_MODE_ID__GEOMETRIC) {
+    std::shared_ptr<program_t> unpacked = std::make_shared<program_t>(inst_lib);
+    UnpackProgram(*genome.program, *unpacked);
+    genome.unpacked = std::move(unpacked);
+  } else {
+    genome.unpacked = std::make_shared<const program_t>(*mctx.program);
+  }
+  ++mctx.copy_cnt;
+  return mut_cnt;
+}
+
+/// Mutate the given agent (program and, if evolving, similarity threshold). Returns the number of mutations.
+///  - Unmutated offspring keep their parent's bindings and traits.
+size_t Experiment::MutateAgent(agent_t & agent, emp::Random & rnd, mut_ctx_t & mctx) {
+  size_t mut_cnt = MutateProgram(agent.GetGenome(), rnd, mctx);
+  if (EVOLVE_SIMILARITY_THRESH) mut_cnt += MutateSimilarityThresh(agent, rnd);
+  if (mut_cnt || !agent.GetGenome().IsPrepared()) PrepareGenome(agent.GetGenome());
+  return mut_cnt;
+}
+
+/// Build the next generation in parallel: copies of the ELITE_SELECT__ELITE_CNT best agents, then mutated offspring
+/// of POP_SIZE - ELITE_SELECT__ELITE_CNT tournament winners. Same outcome distribution as emp::EliteSelect,
+/// emp::TournamentSelect, and World::DoMutations.
+///  - Tournaments run over a precomputed fitness array.
+///  - Offspring are split into chunks of REPRODUCTION_CHUNK_SIZE, each with its own random number stream keyed by
+///    (RANDOM_SEED, update, chunk), so the next generation depends only on the seed, not on the thread count.
+///  - Every worker copies and mutates its chunks' offspring straight into their next_gen slots, with its own
+///    mutation context. Nothing gets released while workers run (every parent is still in the world).
+///  - InstallNextGeneration puts the next generation into the world.
+void Experiment::Reproduce() {
+  const size_t pop_size = world->GetSize();
+  emp_assert(pop_size == POP_SIZE, pop_size, POP_SIZE);
+  // 1) Fitness.
+  repro_fitness.resize(pop_size);
+  for (size_t id = 0; id < pop_size; ++id) repro_fitness[id] = GetFitness(world->GetOrg(id));
+
+  // 2) Elites: best first (among equals, later IDs first, like emp::EliteSelect).
+  const size_t elite_cnt = emp::Min(ELITE_SELECT__ELITE_CNT, pop_size);
+  repro_order.resize(pop_size);
+  for (size_t id = 0; id < pop_size; ++id) repro_order[id] = id;
+  std::partial_sort(repro_order.begin(), repro_order.begin() + elite_cnt, repro_order.end(),
+    [this](size_t a, size_t b) {
+      return (repro_fitness[a] != repro_fitness[b]) ? repro_fitness[a] > repro_fitness[b] : a > b;
+    });
+  while (next_gen.size() < pop_size) next_gen.emplace_back(world->GetOrg(0));
+  for (size_t i = 0; i < elite_cnt; ++i) next_gen[i] = world->GetOrg(repro_order[i]);
+
+  // 3) Tournament winners' offspring.
+  const size_t offspring_cnt = pop_size - elite_cnt;
+  const size_t chunk_cnt = (offspring_cnt + REPRODUCTION_CHUNK_SIZE - 1) / REPRODUCTION_CHUNK_SIZE;
+  const size_t worker_cnt = emp::Max((size_t)1, emp::Min(mut_contexts.size(), chunk_cnt));
+
+  auto reproduce_chunks = [this, pop_size, elite_cnt, offspring_cnt, chunk_cnt, worker_cnt](size_t worker_id) {
+    mut_ctx_t & mctx = *mut_contexts[worker_id];
+    for (size_t chunk = worker_id; chunk < chunk_cnt; chunk += worker_cnt) {
+      mctx.random.ResetSeed(GetStreamSeed(stream_seed, update, (uint64_t)-2, chunk));
+      const size_t end = emp::Min((chunk + 1) * REPRODUCTION_CHUNK_SIZE, offspring_cnt);
+      for (size_t k = chunk * REPRODUCTION_CHUNK_SIZE; k < end; ++k) {
+        // Tournament: entrants drawn with replacement; ties go to the earliest entrant.
+        size_t best_id = mctx.random.GetUInt(pop_size);
+        for (size_t t = 1; t < TOURNAMENT_SIZE; ++t) {
+          const size_t id = mctx.random.GetUInt(pop_size);
+          if (repro_fitness[id] > repro_fitness[best_id]) best_id = id;
+        }
+        agent_t & offspring = next_gen[elite_cnt + k];
+        offspring = world->GetOrg(best_id);
+        MutateAgent(offspring, mctx.random, mctx);
+      }
+    }
+  };
+
+  if (worker_cnt == 1 || !WORKER_THREADS) {
+    for (size_t worker_id = 0; worker_id < worker_cnt; ++worker_id) reproduce_chunks(worker_id);
+  } else {
+    emp::vector<std::thread> workers;
+    for (size_t worker_id = 0; worker_id < worker_cnt; ++worker_id) {
+      workers.emplace_back(reproduce_chunks, worker_id);
+    }
+    for (size_t worker_id = 0; worker_id < worker_cnt; ++worker_id) {
+      workers[worker_id].join();
+    }
+  }
+}
+
+/// Swap the next generation (see Reproduce) into the world.
+///  - The replaced agents' programs get released here, serially (program arenas aren't thread-safe).
+void Experiment::InstallNextGeneration() {
+  emp_assert(next_gen.size() == world->GetSize());
+  for (size_t id = 0; id < next_gen.size(); ++id) {
+    std::swap(world->GetOrg(id), next_gen[id]);
+    next_gen[id].GetGenome().program.reset();
+  }
+}
+
+/// Evaluate the given agents (each into its own phenotype slot) in parallel, one contiguous chunk per evaluation
+/// context. stream_ids[i] keys agents[i]'s random number streams.
+void Experiment::EvaluateAgents(const emp::vector<emp::Ptr<agent_t>> & agents, const emp::vector<size_t> & stream_ids) {
+  emp_assert(agents.size() == stream_ids.size());
+  const size_t eval_cnt = agents.size();
+  const size_t worker_cnt = emp::Max((size_t)1, emp::Min(eval_contexts.size(), eval_cnt));
+  const size_t chunk_size = (eval_cnt + worker_cnt - 1) / worker_cnt;
+
+  auto evaluate_chunk = [this, &agents, &stream_ids, eval_cnt, chunk_size](size_t worker_id) {
+    const size_t end = emp::Min((worker_id + 1) * chunk_size, eval_cnt);
+    for (size_t i = worker_id * chunk_size; i < end; ++i) {
+      this->Evaluate(*eval_contexts[worker_id], *agents[i], stream_ids[i]);
+    }
+  };
+
+  if (worker_cnt == 1 || !WORKER_THREADS) {
+    for (size_t worker_id = 0; worker_id < worker_cnt; ++worker_id) evaluate_chunk(worker_id);
+  } else {
+    emp::vector<std::thread> workers;
+    for (size_t worker_id = 0; worker_id < worker_cnt; ++worker_id) {
+      workers.emplace_back(evaluate_chunk, worker_id);
+    }
+    for (size_t worker_id = 0; worker_id < worker_cnt; ++worker_id) {
+      workers[worker_id].join();
+    }
+  }
+}
+
+/// Archive cell (grid index) of the given (evaluated) agent. Same cell layout as emp::TraitSet::EvalBin (first
+/// axis varies fastest; values outside an axis' range go in its first/last bin).
+uint64_t Experiment::GetMapCell(agent_t & agent) {
+  uint64_t cell = 0;
+  uint64_t mult = 1;
+  for (size_t i = 0; i < map_axes.size(); ++i) {
+    const MapAxis & axis = map_axes[i];
+    const double val = axis.fun(agent);
+    const double bin_width = (axis.max - axis.min) / (double)axis.bin_cnt;
+    size_t bin = (val <= axis.min) ? 0 : (size_t)((val - axis.min) / bin_width);
+    if (bin >= axis.bin_cnt) bin = axis.bin_cnt - 1;
+    cell += bin * mult;
+    mult *= axis.bin_cnt;
+  }
+  return cell;
+}
+
+/// Make sure the sparse MAP-Elites archive can take batch_size more elites, and return the first of batch_size
+/// private phenotype slots for offspring.
+///  - Phenotype storage (and the slot fitness cache) grows geometrically with archive occupancy, not grid size.
+///  - Offspring slots come right after the archive's capacity, so they can't move while a batch gets archived.
+size_t Experiment::ReserveMapSlots(size_t batch_size) {
+  emp_assert(batch_size <= MAP_ELITES_BATCH_SIZE);
+  const size_t needed = map_archive.GetSize() + batch_size;
+  if (needed > map_capacity) {
+    map_capacity = emp::Max(needed, 2 * map_capacity);
+    phen_cache.Grow(map_capacity + MAP_ELITES_BATCH_SIZE);
+    map_slot_fitness.resize(map_capacity, 0.0);
+    map_slot_fitness_update.resize(map_capacity, (size_t)-1);
+  }
+  return map_capacity;
+}
+
+/// Breed and archive one batch of MAP-Elites offspring: pick parents uniformly from the archive and mutate
+/// copies of them (serially, with the world's random number generator, like emp::RandomSelect).
+void Experiment::DoMapElitesBatch(size_t batch_size) {
+  emp_assert(map_archive.GetSize() > 0);
+  const size_t offspring_slot = ReserveMapSlots(batch_size);
+  emp::Random & rnd = world->GetRandom();
+  for (size_t i = 0; i < batch_size; ++i) {
+    const size_t parent_slot = rnd.GetUInt(map_archive.GetSize());
+    if (i < map_offspring.size()) map_offspring[i] = world->GetOrg(parent_slot);
+    else map_offspring.emplace_back(world->GetOrg(parent_slot));
+    mutate_agent(map_offspring[i], rnd);
+    map_offspring[i].SetID(offspring_slot + i);
+  }
+  ArchiveMapOffspring(batch_size);
+}
+
+/// Evaluate and archive the first batch_size agents of map_offspring (IDs: private phenotype slots from
+/// ReserveMapSlots). An offspring takes over its cell unless the cell's elite is strictly fitter. This differs from
+/// emp::SetMapElites in two ways:
+///  - The whole batch is bred from the archive as it was at the start of the batch.
+///  - An offspring placed earlier in the batch is challenged with the score it was just evaluated with; it isn't
+///    re-evaluated until a later batch challenges it.
+///  1) Evaluate every offspring in parallel, then compute its cell from its cached traits and its phenotype.
+///  2) Re-evaluate (in parallel, in their own slots) challenged elites with no fitness cached this update.
+///  3) Insert offspring into the archive in batch order (later offspring win ties). Empty cells get new slots
+///     (and world positions).
+/// Random number streams are keyed by evaluation order within the update, so results don't depend on EVAL_THREADS.
+void Experiment::ArchiveMapOffspring(size_t batch_size) {
+  // 1) Evaluate offspring.
+  map_eval_agents.resize(batch_size);
+  map_eval_stream_ids.resize(batch_size);
+  for (size_t i = 0; i < batch_size; ++i) {
+    map_eval_agents[i] = &map_offspring[i];
+    map_eval_stream_ids[i] = update_eval_cnt++;
+  }
+  EvaluateAgents(map_eval_agents, map_eval_stream_ids);
+  map_offspring_cells.resize(batch_size);
+  for (size_t i = 0; i < batch_size; ++i) map_offspring_cells[i] = GetMapCell(map_offspring[i]);
+
+  // 2) Re-evaluate challenged elites.
+  map_eval_agents.clear();
+  map_eval_stream_ids.clear();
+  for (size_t i = 0; i < batch_size; ++i) {
+    const size_t slot = map_archive.Find(map_offspring_cells[i]);
+    if (slot == MapArchive::NO_SLOT || map_slot_fitness_update[slot] == update) continue;
+    map_slot_fitness_update[slot] = update;
+    emp_assert(world->GetOrg(slot).GetID() == slot);
+    map_eval_agents.emplace_back(&world->GetOrg(slot));
+    map_eval_stream_ids.emplace_back(update_eval_cnt++);
+  }
+  EvaluateAgents(map_eval_agents, map_eval_stream_ids);
+  for (size_t i = 0; i < map_eval_agents.size(); ++i) {
+    const size_t slot = map_eval_agents[i]->GetID();
+    map_slot_fitness[slot] = GetFitness(*map_eval_agents[i]);
+    if (map_slot_fitness[slot] > best_score) { best_score = map_slot_fitness[slot]; dom_agent_id = slot; }
+  }
+
+  // 3) Insert.
+  map_placed_slots.clear();
+  for (size_t i = 0; i < batch_size; ++i) {
+    size_t slot = map_archive.Find(map_offspring_cells[i]);
+    const double score = GetFitness(map_offspring[i]);
+    const double cur_fitness = (slot == MapArchive::NO_SLOT) ? 0.0 : map_slot_fitness[slot];
+    if (score > best_score) best_score = score;
+    if (cur_fitness > score) continue;
+    if (slot == MapArchive::NO_SLOT) {
+      slot = map_archive.Insert(map_offspring_cells[i]);
+      emp_assert(slot < map_capacity);
+      world->Resize(map_archive.GetSize());
+    }
+    phen_cache.CopyAgent(map_offspring[i].GetID(), slot);
+    world->InjectAt(map_offspring[i], emp::WorldPosition(slot));
+    world->GetOrg(slot).SetID(slot);
+    map_slot_fitness[slot] = score;
+    map_slot_fitness_update[slot] = update;
+    map_placed_slots.emplace_back(slot);
+    if (score >= best_score) dom_agent_id = slot;
+  }
+  // New elites get re-evaluated the next time they're challenged.
+  for (size_t i = 0; i < map_placed_slots.size(); ++i) map_slot_fitness_update[map_placed_slots[i]] = (size_t)-1;
+}
+
+/// Add copies of the given genome to the population: through the world, or (sparse MAP-Elites archive) evaluated
+/// and archived like batches of offspring.
+void Experiment::InjectGenome(const genome_t & genome, size_t copies) {
+  if (!UseSparseMapArchive()) {
+    world->Inject(genome, copies);
+    return;
+  }
+  for (size_t done = 0; done < copies; done += MAP_ELITES_BATCH_SIZE) {
+    const size_t batch_size = emp::Min(MAP_ELITES_BATCH_SIZE, copies - done);
+    const size_t offspring_slot = ReserveMapSlots(batch_size);
+    for (size_t i = 0; i < batch_size; ++i) {
+      if (i < map_offspring.size()) map_offspring[i] = agent_t(genome);
+      else map_offspring.emplace_back(genome);
+      map_offspring[i].SetID(offspring_slot + i);
+    }
+    ArchiveMapOffspring(batch_size);
+  }
+}
+
 size_t Experiment::MutateSimilarityThresh(agent_t & agent, emp::Random & rnd) {
   // TODO: double check functionality of this mutation operator
   if (rnd.P(SGP_MUT_PER_AGENT__SIM_THRESH_RATE)) {
@@ -798,6 +2255,66 @@ size_t Experiment::MutateSimilarityThresh(agent_t & agent, emp::Random & rnd) {
 
 // == utility functions ==
 
+/// Utility function to build one mutation context per reproduction thread (at least one, for serial mutation).
+///  - Must be called once the mutators are fully configured (mutation contexts get copies).
+void Experiment::InitMutationContexts() {
+  const size_t ctx_cnt = emp::Max(REPRODUCTION_THREADS, (size_t)1);
+  for (size_t i = 0; i < ctx_cnt; ++i) {
+    if (i == 0) {
+      mut_contexts.emplace_back(emp::NewPtr<mut_ctx_t>(emp::Ptr<packed_arena_t>(&program_arena), false, inst_lib,
+                                                       mutator, packed_mutator));
+    } else {
+      mut_contexts.emplace_back(emp::NewPtr<mut_ctx_t>(emp::NewPtr<packed_arena_t>(), true, inst_lib,
+                                                       mutator, packed_mutator));
+    }
+  }
+}
+
+/// Utility function to build one evaluation context per evaluation thread.
+///  - Context 0 shares the experiment's random number generator (serial evaluations are unchanged).
+///  - Every other context gets its own random number generator seeded from the experiment's.
+///  - With per-trial random number streams, every context owns its generator (they get reseeded every trial).
+void Experiment::InitEvalContexts() {
+  if (UseLockstepHardware() && !ENVIRONMENT_COMMON_SCHEDULES) {
+    std::cout << "Lockstep evaluation (EVAL_BATCH_SIZE > 1 or EVAL_FLAT_HARDWARE) requires ENVIRONMENT_COMMON_SCHEDULES. Exiting..." << std::endl;
+    exit(-1);
+  }
+  const size_t ctx_cnt = emp::Max(EVAL_THREADS, (size_t)1);
+  for (size_t i = 0; i < ctx_cnt; ++i) {
+    emp::Ptr<eval_ctx_t> ctx;
+    if (i == 0 && EVAL_RNG_MODE == EVAL_RNG_MODE_ID__SHARED) {
+      ctx = emp::NewPtr<eval_ctx_t>(i, random, false, task_set);
+    } else {
+      emp::Ptr<emp::Random> rnd = emp::NewPtr<emp::Random>(random->GetInt(1, std::numeric_limits<int>::max()));
+      ctx = emp::NewPtr<eval_ctx_t>(i, rnd, true, task_set);
+    }
+    ctx->hw = emp::NewPtr<hardware_t>(inst_lib, event_lib, ctx->random);
+    ctx->program = emp::NewPtr<program_t>(inst_lib);
+    // Setup lockstep hardware.
+    if (UseLockstepHardware()) {
+      const size_t lanes = GetLockstepLanes();
+      ctx->batch_hw = emp::NewPtr<batch_hw_t>(lanes, SGP_HW_MAX_CORES, SGP_HW_MAX_CALL_DEPTH);
+      ctx->batch_programs.resize(lanes);
+      ctx->batch_task_sets.resize(lanes, task_set);
+      ctx->batch_ids.resize(lanes, 0);
+      ctx->batch_agents.resize(lanes, nullptr);
+      if (EVAL_RNG_MODE == EVAL_RNG_MODE_ID__TRIAL_STREAMS) {
+        // Reseeded at the beginning of every trial.
+        for (size_t k = 0; k < lanes; ++k) ctx->batch_randoms.emplace_back(emp::NewPtr<emp::Random>(1));
+      }
+    }
+    // Populate environment shuffler!
+    for (size_t k = 0; k < env_state_tags.size(); ++k) ctx->env_shuffler.emplace_back(k);
+    ctx->env_shuffle_id = 0;
+    eval_contexts.emplace_back(ctx);
+  }
+  std::cout << "Evaluation contexts: " << eval_contexts.size() << std::endl;
+  if (UseLockstepHardware()) {
+    std::cout << "Lockstep lanes per context: " << GetLockstepLanes() << " (call-state pool: "
+              << eval_contexts[0]->batch_hw->GetFramePoolBytes() << " bytes per context)" << std::endl;
+  }
+}
+
 /// Utility function to save environment tags.
 void Experiment::SaveEnvTags() {
   // Save out environment states.
@@ -876,11 +2393,20 @@ void Experiment::InitPopulation__FromAncestorFile() {
     exit(-1);
   }
   ancestor_prog.Load(ancestor_fstream);
+  if (ancestor_prog.GetSize() > MAX_FUNC_CNT) {
+    std::cout << "Ancestor program has more than " << MAX_FUNC_CNT << " functions. Exiting..." << std::endl;
+    exit(-1);
+  }
+  if (!CanPackProgram(ancestor_prog)) {
+    std::cout << "Ancestor program has instruction arguments outside [0, " << packed_program_t::MAX_ARG << "]. Exiting..." << std::endl;
+    exit(-1);
+  }
   std::cout << " --- Ancestor program: ---" << std::endl;
   ancestor_prog.PrintProgramFull();
   std::cout << " -------------------------" << std::endl;
-  genome_t ancestor_genome(ancestor_prog, SGP_HW_MIN_BIND_THRESH);
-  world->Inject(ancestor_genome, POP_SIZE);    // Inject population!
+  genome_t ancestor_genome(PackProgram(ancestor_prog), SGP_HW_MIN_BIND_THRESH, KeepUnpacked(ancestor_prog));
+  PrepareGenome(ancestor_genome);
+  InjectGenome(ancestor_genome, POP_SIZE);    // Inject population!
 }
 
 void Experiment::InitPopulation__Random() {
@@ -903,8 +2429,10 @@ void Experiment::InitPopulation__Random() {
       }
       ancestor_prog.PushFunction(new_fun);
     }
-    genome_t ancestor_genome(ancestor_prog, random->GetDouble(MIN_SIM_THRESH, MAX_SIM_THRESH));
-    world->Inject(ancestor_genome, 1);  
+    genome_t ancestor_genome(PackProgram(ancestor_prog), random->GetDouble(MIN_SIM_THRESH, MAX_SIM_THRESH),
+                             KeepUnpacked(ancestor_prog));
+    PrepareGenome(ancestor_genome);
+    InjectGenome(ancestor_genome, 1);
   }
   std::cout << "Done randomly initializing population!" << std::endl;
 }
@@ -919,7 +2447,8 @@ void Experiment::Snapshot__Programs(size_t u) {
     if (!world->IsOccupied(i)) continue;
     prog_ofstream << "==="<<i<<":"<<world->CalcFitnessID(i)<<","<<world->GetOrg(i).GetSimilarityThreshold()<<"===\n";
     Agent & agent = world->GetOrg(i);
-    agent.GetProgram().PrintProgramFull(prog_ofstream);
+    UnpackProgram(agent.GetProgram(), *scratch_program);
+    scratch_program->PrintProgramFull(prog_ofstream);
   }
   prog_ofstream.close();
 }
@@ -937,81 +2466,81 @@ void Experiment::Snapshot__PopulationStats(size_t u) {
   file.AddFun(get_id, "id", "...");
 
   std::function<size_t(void)> get_func_cnt = [this, &world_id]() {
-    phenotype_t & phen = phen_cache.GetRepresentativePhen(world_id);
+    phenotype_t phen = phen_cache.GetRepresentativePhen(world_id);
     return phen.GetFunctionCnt();
   };
   file.AddFun(get_func_cnt, "func_cnt", "Number of functions in program");
 
   std::function<size_t(void)> get_func_used = [this, &world_id]() {
-    phenotype_t & phen = phen_cache.GetRepresentativePhen(world_id);
+    phenotype_t phen = phen_cache.GetRepresentativePhen(world_id);
     return phen.GetFunctionsUsed();
   };
   file.AddFun(get_func_used, "func_used", "...");
 
   std::function<double(void)> get_inst_ent = [this, &world_id]() {
-    phenotype_t & phen = phen_cache.GetRepresentativePhen(world_id);
+    phenotype_t phen = phen_cache.GetRepresentativePhen(world_id);
     return phen.GetInstEntropy();
   };
   file.AddFun(get_inst_ent, "inst_entropy", "...");
 
   std::function<double(void)> get_sim_thresh = [this, &world_id]() {
-    phenotype_t & phen = phen_cache.GetRepresentativePhen(world_id);
+    phenotype_t phen = phen_cache.GetRepresentativePhen(world_id);
     return phen.GetSimilarityThreshold();
   };
   file.AddFun(get_sim_thresh, "sim_thresh", "...");
 
   std::function<double(void)> get_score = [this, &world_id]() {
-    phenotype_t & phen = phen_cache.GetRepresentativePhen(world_id);
+    phenotype_t phen = phen_cache.GetRepresentativePhen(world_id);
     return phen.GetScore();
   };
   file.AddFun(get_score, "score", "...");
 
   std::function<size_t(void)> get_env_match_score = [this, &world_id]() {
-    phenotype_t & phen = phen_cache.GetRepresentativePhen(world_id);
+    phenotype_t phen = phen_cache.GetRepresentativePhen(world_id);
     return phen.GetEnvMatchScore();
   };
   file.AddFun(get_env_match_score, "env_matches", "...");
 
   if (TASKS_ON) {
     std::function<size_t(void)> get_time_all_tasks_credited = [this, &world_id]() {
-      phenotype_t & phen = phen_cache.GetRepresentativePhen(world_id);
+      phenotype_t phen = phen_cache.GetRepresentativePhen(world_id);
       return phen.GetTimeAllTasksCredited();
     };
     file.AddFun(get_time_all_tasks_credited, "time_all_tasks_credited", "...");
 
     std::function<size_t(void)> get_unique_tasks_completed = [this, &world_id]() {
-      phenotype_t & phen = phen_cache.GetRepresentativePhen(world_id);
+      phenotype_t phen = phen_cache.GetRepresentativePhen(world_id);
       return phen.GetUniqueTasksCompleted();
     };
     file.AddFun(get_unique_tasks_completed, "total_unique_tasks_completed", "...");
 
     std::function<size_t(void)> get_total_wasted_completions = [this, &world_id]() {
-      phenotype_t & phen = phen_cache.GetRepresentativePhen(world_id);
+      phenotype_t phen = phen_cache.GetRepresentativePhen(world_id);
       return phen.GetTotalWastedCompletions();
     };
     file.AddFun(get_total_wasted_completions, "total_wasted_completions", "...");
 
     std::function<size_t(void)> get_unique_tasks_credited = [this, &world_id]() {
-      phenotype_t & phen = phen_cache.GetRepresentativePhen(world_id);
+      phenotype_t phen = phen_cache.GetRepresentativePhen(world_id);
       return phen.GetUniqueTasksCredited();
     };
     file.AddFun(get_unique_tasks_credited, "total_unique_tasks_credited", "...");
 
     for (size_t i = 0; i < task_set.GetSize(); ++i) {
       std::function<size_t(void)> get_wasted = [this, i, &world_id]() {
-      phenotype_t & phen = phen_cache.GetRepresentativePhen(world_id);
+      phenotype_t phen = phen_cache.GetRepresentativePhen(world_id);
         return phen.GetWastedCompletions(i);
       };
       file.AddFun(get_wasted, "wasted_"+task_set.GetName(i), "...");
 
       std::function<size_t(void)> get_completed = [this, i, &world_id]() {
-      phenotype_t & phen = phen_cache.GetRepresentativePhen(world_id);
+      phenotype_t phen = phen_cache.GetRepresentativePhen(world_id);
         return phen.GetCompleted(i);
       };
       file.AddFun(get_completed, "completed_"+task_set.GetName(i), "...");
 
       std::function<size_t(void)> get_credited = [this, i, &world_id]() {
-      phenotype_t & phen = phen_cache.GetRepresentativePhen(world_id);
+      phenotype_t phen = phen_cache.GetRepresentativePhen(world_id);
         return phen.GetCredited(i);
       };
       file.AddFun(get_credited, "credited_"+task_set.GetName(i), "...");
@@ -1024,7 +2553,7 @@ void Experiment::Snapshot__PopulationStats(size_t u) {
     if (!world->IsOccupied(world_id)) continue;
     agent_t & agent = world->GetOrg(world_id);
     agent.SetID(world_id);
-    this->Evaluate(agent);
+    this->Evaluate(*eval_contexts[0], agent);
     file.Update();
   }
 }
@@ -1035,19 +2564,9 @@ void Experiment::Snapshot__Dominant(size_t u) {
   std::string snapshot_dir = DATA_DIRECTORY + "pop_" + emp::to_string((int)u);
   mkdir(snapshot_dir.c_str(), ACCESSPERMS);
   
-  emp::vector<double> scores(DOM_SNAPSHOT_TRIAL_CNT,0);
-  
-  agent_t & dom_agent = world->GetOrg(dom_agent_id);
-
-  begin_agent_eval_sig.Trigger(dom_agent);
-  for (size_t i = 0; i < DOM_SNAPSHOT_TRIAL_CNT; ++i) {
-    trial_id = 0;
-    begin_agent_trial_sig.Trigger(dom_agent);
-    do_agent_trial_sig.Trigger(dom_agent);
-    end_agent_trial_sig.Trigger(dom_agent);
-    // Grab score
-    scores[i] = phen_cache.Get(dom_agent.GetID(), trial_id).GetScore();
-  }
+  snapshot_agents.assign(1, &world->GetOrg(dom_agent_id));
+  snapshot_stream_ids.assign(1, dom_agent_id);
+  EvaluateSnapshots(DOM_SNAPSHOT_TRIAL_CNT, true);
 
   // Output stuff to file.
   // Output shit.
@@ -1055,9 +2574,16 @@ void Experiment::Snapshot__Dominant(size_t u) {
   // Fill out the header.
   prog_ofstream << "trial,fitness";
   for (size_t tID = 0; tID < DOM_SNAPSHOT_TRIAL_CNT; ++tID) {
-    prog_ofstream << "\n" << tID << "," << scores[tID];
+    prog_ofstream << "\n" << tID << "," << snapshot_scores[tID];
   }
   prog_ofstream.close();
+
+  // How many times was each of the dominant agent's functions called (or spawned on) over the snapshot trials?
+  std::ofstream calls_ofstream(snapshot_dir + "/dom_calls_" + emp::to_string((int)u) + ".csv");
+  calls_ofstream << "function,calls";
+  const size_t func_cnt = emp::Min(snapshot_agents[0]->GetGenome().traits.func_cnt, snapshot_call_cnts.size());
+  for (size_t fID = 0; fID < func_cnt; ++fID) calls_ofstream << "\n" << fID << "," << snapshot_call_cnts[fID];
+  calls_ofstream.close();
 }
 
 void Experiment::Snapshot__MAP(size_t u) {
@@ -1070,31 +2596,25 @@ void Experiment::Snapshot__MAP(size_t u) {
   // Fill out the header.
   prog_ofstream << "agent_id,trial,fitness,func_cnt,func_used,inst_entropy,sim_thresh";
   
+  // Evaluate every elite, then write everything out.
+  snapshot_agents.clear();
+  snapshot_stream_ids.clear();
   for (size_t aID = 0; aID < world->GetSize(); ++aID) {
     if (!world->IsOccupied(aID)) continue;
-    agent_t & agent = world->GetOrg(aID);
-
-
-    emp::vector<double> scores(DOM_SNAPSHOT_TRIAL_CNT, 0);
-    emp::vector<size_t> func_used(DOM_SNAPSHOT_TRIAL_CNT, 0);
-
-    begin_agent_eval_sig.Trigger(agent);
-    for (size_t i = 0; i < DOM_SNAPSHOT_TRIAL_CNT; ++i) {
-      trial_id = 0;
-      begin_agent_trial_sig.Trigger(agent);
-      do_agent_trial_sig.Trigger(agent);
-      end_agent_trial_sig.Trigger(agent);
-      // Grab score
-      scores[i] = phen_cache.Get(agent.GetID(), trial_id).GetScore();
-      func_used[i] = phen_cache.Get(agent.GetID(), trial_id).GetFunctionsUsed();
-    }
-    double entropy = phen_cache.Get(agent.GetID(), 0).GetInstEntropy();
-    double sim_thresh = phen_cache.Get(agent.GetID(), 0).GetSimilarityThreshold();
-    size_t func_cnt = phen_cache.Get(agent.GetID(), 0).GetFunctionCnt();
-
-    // Output stuff to file.
+    snapshot_agents.emplace_back(&world->GetOrg(aID));
+    snapshot_stream_ids.emplace_back(aID);
+  }
+  EvaluateSnapshots(DOM_SNAPSHOT_TRIAL_CNT);
+
+  for (size_t i = 0; i < snapshot_agents.size(); ++i) {
+    const size_t aID = snapshot_stream_ids[i];
+    // World positions are archive slots with a sparse archive.
+    const uint64_t cell = (UseSparseMapArchive()) ? map_archive.GetCell(aID) : aID;
+    const genome_t & genome = snapshot_agents[i]->GetGenome();
+    const double * scores = snapshot_scores.data() + i * DOM_SNAPSHOT_TRIAL_CNT;
+    const size_t * func_used = snapshot_funcs_used.data() + i * DOM_SNAPSHOT_TRIAL_CNT;
     for (size_t tID = 0; tID < DOM_SNAPSHOT_TRIAL_CNT; ++tID) {
-      prog_ofstream << "\n" << aID << "," << tID << "," << scores[tID] << "," << func_cnt << "," << func_used[tID] << "," << entropy << "," << sim_thresh;
+      prog_ofstream << "\n" << cell << "," << tID << "," << scores[tID] << "," << genome.traits.func_cnt << "," << func_used[tID] << "," << genome.traits.inst_entropy << "," << genome.sim_thresh;
     }
   }
   prog_ofstream.close();
@@ -1107,81 +2627,81 @@ emp::DataFile & Experiment::AddDominantFile(const std::string & fpath="dominant.
   file.AddFun(get_update, "update", "Update");
 
   std::function<size_t(void)> get_func_cnt = [this]() {
-    phenotype_t & phen = phen_cache.GetRepresentativePhen(dom_agent_id);
+    phenotype_t phen = phen_cache.GetRepresentativePhen(dom_agent_id);
     return phen.GetFunctionCnt();
   };
   file.AddFun(get_func_cnt, "func_cnt", "Number of functions in program");
 
   std::function<size_t(void)> get_func_used = [this]() {
-    phenotype_t & phen = phen_cache.GetRepresentativePhen(dom_agent_id);
+    phenotype_t phen = phen_cache.GetRepresentativePhen(dom_agent_id);
     return phen.GetFunctionsUsed();
   };
   file.AddFun(get_func_used, "func_used", "Number of functions used by program");
 
   std::function<double(void)> get_inst_ent = [this]() {
-    phenotype_t & phen = phen_cache.GetRepresentativePhen(dom_agent_id);
+    phenotype_t phen = phen_cache.GetRepresentativePhen(dom_agent_id);
     return phen.GetInstEntropy();
   };
   file.AddFun(get_inst_ent, "inst_entropy", "Instruction entropy of program");
 
   std::function<double(void)> get_sim_thresh = [this]() {
-    phenotype_t & phen = phen_cache.GetRepresentativePhen(dom_agent_id);
+    phenotype_t phen = phen_cache.GetRepresentativePhen(dom_agent_id);
     return phen.GetSimilarityThreshold();
   };
   file.AddFun(get_sim_thresh, "sim_thresh", "Similarity threshold of program");
 
   std::function<double(void)> get_score = [this]() {
-    phenotype_t & phen = phen_cache.GetRepresentativePhen(dom_agent_id);
+    phenotype_t phen = phen_cache.GetRepresentativePhen(dom_agent_id);
     return phen.GetScore();
   };
   file.AddFun(get_score, "score", "Score of program");
 
   std::function<size_t(void)> get_env_match_score = [this]() {
-    phenotype_t & phen = phen_cache.GetRepresentativePhen(dom_agent_id);
+    phenotype_t phen = phen_cache.GetRepresentativePhen(dom_agent_id);
     return phen.GetEnvMatchScore();
   };
   file.AddFun(get_env_match_score, "env_matches", "Number of environment states matched by agent");
 
   if (TASKS_ON) { 
     std::function<size_t(void)> get_time_all_tasks_credited = [this]() {
-      phenotype_t & phen = phen_cache.GetRepresentativePhen(dom_agent_id);
+      phenotype_t phen = phen_cache.GetRepresentativePhen(dom_agent_id);
       return phen.GetTimeAllTasksCredited();
     };
     file.AddFun(get_time_all_tasks_credited, "time_all_tasks_credited", "...");
 
     std::function<size_t(void)> get_unique_tasks_completed = [this]() {
-      phenotype_t & phen = phen_cache.GetRepresentativePhen(dom_agent_id);
+      phenotype_t phen = phen_cache.GetRepresentativePhen(dom_agent_id);
       return phen.GetUniqueTasksCompleted();
     };
     file.AddFun(get_unique_tasks_completed, "total_unique_tasks_completed", "...");
 
     std::function<size_t(void)> get_total_wasted_completions = [this]() {
-      phenotype_t & phen = phen_cache.GetRepresentativePhen(dom_agent_id);
+      phenotype_t phen = phen_cache.GetRepresentativePhen(dom_agent_id);
       return phen.GetTotalWastedCompletions();
     };
     file.AddFun(get_total_wasted_completions, "total_wasted_completions", "...");
 
     std::function<size_t(void)> get_unique_tasks_credited = [this]() {
-      phenotype_t & phen = phen_cache.GetRepresentativePhen(dom_agent_id);
+      phenotype_t phen = phen_cache.GetRepresentativePhen(dom_agent_id);
       return phen.GetUniqueTasksCredited();
     };
     file.AddFun(get_unique_tasks_credited, "total_unique_tasks_credited", "...");
 
     for (size_t i = 0; i < task_set.GetSize(); ++i) {
       std::function<size_t(void)> get_wasted = [this, i]() {
-        phenotype_t & phen = phen_cache.GetRepresentativePhen(dom_agent_id);
+        phenotype_t phen = phen_cache.GetRepresentativePhen(dom_agent_id);
         return phen.GetWastedCompletions(i);
       };
       file.AddFun(get_wasted, "wasted_"+task_set.GetName(i), "...");
 
       std::function<size_t(void)> get_completed = [this, i]() {
-        phenotype_t & phen = phen_cache.GetRepresentativePhen(dom_agent_id);
+        phenotype_t phen = phen_cache.GetRepresentativePhen(dom_agent_id);
         return phen.GetCompleted(i);
       };
       file.AddFun(get_completed, "completed_"+task_set.GetName(i), "...");
 
       std::function<size_t(void)> get_credited = [this, i]() {
-        phenotype_t & phen = phen_cache.GetRepresentativePhen(dom_agent_id);
+        phenotype_t phen = phen_cache.GetRepresentativePhen(dom_agent_id);
         return phen.GetCredited(i);
       };
       file.AddFun(get_credited, "credited_"+task_set.GetName(i), "...");
@@ -1195,63 +2715,15 @@ emp::DataFile & Experiment::AddDominantFile(const std::string & fpath="dominant.
 
 // == Configuration functions ==
 void Experiment::DoConfig__Tasks() {
-  // Zero out task inputs.
-  for (size_t i = 0; i < MAX_TASK_NUM_INPUTS; ++i) task_inputs[i] = 0;
-  // Add tasks to task set.
-  // NAND
-  task_set.AddTask("NAND", [](taskset_t::Task & task, const std::array<task_io_t, MAX_TASK_NUM_INPUTS> & inputs) {
-    const task_io_t a = inputs[0], b = inputs[1];
-    task.solutions.emplace_back(~(a&b));
-  }, "NAND task");
-  // NOT
-  task_set.AddTask("NOT", [](taskset_t::Task & task, const std::array<task_io_t, MAX_TASK_NUM_INPUTS> & inputs) {
-    const task_io_t a = inputs[0], b = inputs[1];
-    task.solutions.emplace_back(~a);
-    task.solutions.emplace_back(~b);
-  }, "NOT task");
-  // ORN
-  task_set.AddTask("ORN", [](taskset_t::Task & task, const std::array<task_io_t, MAX_TASK_NUM_INPUTS> & inputs) {
-    const task_io_t a = inputs[0], b = inputs[1];
-    task.solutions.emplace_back((a|(~b)));
-    task.solutions.emplace_back((b|(~a)));
-  }, "ORN task");
-  // AND
-  task_set.AddTask("AND", [](taskset_t::Task & task, const std::array<task_io_t, MAX_TASK_NUM_INPUTS> & inputs) {
-    const task_io_t a = inputs[0], b = inputs[1];
-    task.solutions.emplace_back(a&b);
-  }, "AND task");
-  // OR
-  task_set.AddTask("OR", [](taskset_t::Task & task, const std::array<task_io_t, MAX_TASK_NUM_INPUTS> & inputs) {
-    const task_io_t a = inputs[0], b = inputs[1];
-    task.solutions.emplace_back(a|b);
-  }, "OR task");
-  // ANDN
-  task_set.AddTask("ANDN", [](taskset_t::Task & task, const std::array<task_io_t, MAX_TASK_NUM_INPUTS> & inputs) {
-    const task_io_t a = inputs[0], b = inputs[1];
-    task.solutions.emplace_back((a&(~b)));
-    task.solutions.emplace_back((b&(~a)));
-  }, "ANDN task");
-  // NOR
-  task_set.AddTask("NOR", [](taskset_t::Task & task, const std::array<task_io_t, MAX_TASK_NUM_INPUTS> & inputs) {
-    const task_io_t a = inputs[0], b = inputs[1];
-    task.solutions.emplace_back(~(a|b));
-  }, "NOR task");
-  // XOR
-  task_set.AddTask("XOR", [](taskset_t::Task & task, const std::array<task_io_t, MAX_TASK_NUM_INPUTS> & inputs) {
-    const task_io_t a = inputs[0], b = inputs[1];
-    task.solutions.emplace_back(a^b);
-  }, "XOR task");
-  // EQU
-  task_set.AddTask("EQU", [](taskset_t::Task & task, const std::array<task_io_t, MAX_TASK_NUM_INPUTS> & inputs) {
-    const task_io_t a = inputs[0], b = inputs[1];
-    task.solutions.emplace_back(~(a^b));
-  }, "EQU task");
-  // ECHO
-  task_set.AddTask("ECHO", [](taskset_t::Task & task, const std::array<task_io_t, MAX_TASK_NUM_INPUTS> & inputs) {
-    const task_io_t a = inputs[0], b = inputs[1];
-    task.solutions.emplace_back(a);
-    task.solutions.emplace_back(b);
-  }, "ECHO task");
+  // Add tasks to task set (NAND, NOT, ORN, AND, OR, ANDN, NOR, XOR, EQU, ECHO).
+  //  - Solutions come from the compile-time logic task table; trials set them with TaskSet::SetSolutions.
+  for (size_t i = 0; i < LOGIC_TASK_CNT; ++i) {
+    const LogicTaskInfo & info = LOGIC_TASKS[i];
+    task_set.AddTask(info.name, [i](taskset_t::Task & task, const std::array<task_io_t, MAX_TASK_NUM_INPUTS> & inputs) {
+      const task_solutions_t sols = LogicTaskSolutions(inputs[0], inputs[1]);
+      for (size_t s = 0; s < LOGIC_TASKS[i].sol_cnt; ++s) task.solutions.emplace_back(sols[LOGIC_TASKS[i].sol_begin + s]);
+    }, info.desc, info.sol_cnt);
+  }
 }
 
 void Experiment::DoConfig__Hardware() {
@@ -1273,7 +2745,7 @@ void Experiment::DoConfig__Hardware() {
   inst_lib->AddInst("Countdown", hardware_t::Inst_Countdown, 1, "Local memory: Countdown Arg1 to zero.", emp::ScopeType::BASIC, 0, {"block_def"});
   inst_lib->AddInst("Close", hardware_t::Inst_Close, 0, "Close current block if there is a block to close.", emp::ScopeType::BASIC, 0, {"block_close"});
   inst_lib->AddInst("Break", hardware_t::Inst_Break, 0, "Break out of current block.");
-  inst_lib->AddInst("Call", hardware_t::Inst_Call, 0, "Call function that best matches call affinity.", emp::ScopeType::BASIC, 0, {"affinity"});
+  inst_lib->AddInst("Call", [this](hardware_t & hw, const inst_t & inst) { this->Inst_Call(hw, inst); }, 0, "Call function that best matches call affinity.", emp::ScopeType::BASIC, 0, {"affinity"});
   inst_lib->AddInst("Return", hardware_t::Inst_Return, 0, "Return from current function if possible.");
   inst_lib->AddInst("SetMem", hardware_t::Inst_SetMem, 2, "Local memory: Arg1 = numerical value of Arg2");
   inst_lib->AddInst("CopyMem", hardware_t::Inst_CopyMem, 2, "Local memory: Arg1 = Arg2");
@@ -1283,7 +2755,7 @@ void Experiment::DoConfig__Hardware() {
   inst_lib->AddInst("Commit", hardware_t::Inst_Commit, 2, "Local memory Arg1 => Shared memory Arg2.");
   inst_lib->AddInst("Pull", hardware_t::Inst_Pull, 2, "Shared memory Arg1 => Shared memory Arg2.");
   inst_lib->AddInst("Nop", hardware_t::Inst_Nop, 0, "No operation.");
-  inst_lib->AddInst("Fork", Inst_Fork, 0, "Fork a new thread. Local memory contents of callee are loaded into forked thread's input memory.");
+  inst_lib->AddInst("Fork", [this](hardware_t & hw, const inst_t & inst) { this->Inst_Fork(hw, inst); }, 0, "Fork a new thread. Local memory contents of callee are loaded into forked thread's input memory.");
   inst_lib->AddInst("Terminate", Inst_Terminate, 0, "Kill current thread.");
 
   // Add experiment-specific instructions
@@ -1305,7 +2777,7 @@ void Experiment::DoConfig__Hardware() {
   // Add events!
   if (SGP_ENVIRONMENT_SIGNALS) {
     // Use event-driven events.
-    event_lib->AddEvent("EnvSignal", HandleEvent__EnvSignal_ED, "");
+    event_lib->AddEvent("EnvSignal", [this](hardware_t & hw, const event_t & event) { this->HandleEvent__EnvSignal_ED(hw, event); }, "");
     event_lib->RegisterDispatchFun("EnvSignal", DispatchEvent__EnvSignal_ED);
   } else {
     // Use nop events.
@@ -1320,7 +2792,7 @@ void Experiment::DoConfig__Hardware() {
       inst_lib->AddInst("SenseState-" + emp::to_string(i),
         [this, i](hardware_t & hw, const inst_t & inst) {
           state_t & state = hw.GetCurState();
-          state.SetLocal(inst.args[0], this->env_state==i);
+          state.SetLocal(inst.args[0], this->GetEvalContext(hw).env_state==i);
         }, 1, "Sense if current environment state is " + emp::to_string(i));
     }
   } else {
@@ -1333,32 +2805,49 @@ void Experiment::DoConfig__Hardware() {
   }
 
   // Configure evaluation hardware.
-  eval_hw->SetMinBindThresh(SGP_HW_MIN_BIND_THRESH);
-  eval_hw->SetMaxCores(SGP_HW_MAX_CORES);
-  eval_hw->SetMaxCallDepth(SGP_HW_MAX_CALL_DEPTH);
+  for (size_t i = 0; i < eval_contexts.size(); ++i) {
+    emp::Ptr<hardware_t> eval_hw = eval_contexts[i]->hw;
+    eval_hw->SetMinBindThresh(SGP_HW_MIN_BIND_THRESH);
+    eval_hw->SetMaxCores(SGP_HW_MAX_CORES);
+    eval_hw->SetMaxCallDepth(SGP_HW_MAX_CALL_DEPTH);
+  }
+
+  if (inst_lib->GetSize() > packed_program_t::MAX_INST_ID + 1) {
+    std::cout << "Cannot pack programs with more than " << packed_program_t::MAX_INST_ID + 1 << " instructions in the instruction library. Exiting..." << std::endl;
+    exit(-1);
+  }
+  packed_mutator.SetInstCnt(inst_lib->GetSize());
+
+  // Map instructions onto lockstep hardware opcodes.
+  lockstep_opcodes.resize(inst_lib->GetSize(), -1);
+  lockstep_imms.resize(inst_lib->GetSize(), 0);
+  for (size_t i = 0; i < inst_lib->GetSize(); ++i) {
+    uint8_t op = 0;
+    uint32_t imm = 0;
+    if (!batch_hw_t::GetOpcode(inst_lib->GetName(i), op, imm)) continue;
+    // Non-functional sensors do nothing.
+    if (op == batch_hw_t::OP_SENSE_STATE && !SGP_ACTIVE_SENSORS) op = batch_hw_t::OP_NOP;
+    lockstep_opcodes[i] = (int)op;
+    lockstep_imms[i] = imm;
+  }
 
   max_inst_entropy = -1 * emp::Log2(1.0/((double)inst_lib->GetSize()));
   std::cout << "Maximum instruction entropy: " << max_inst_entropy << std::endl;
 
-  inst_ent_fun = [](agent_t & agent) {
-    emp::vector<inst_t> inst_seq;
-    program_t & prog = agent.GetProgram();
-    for (size_t i = 0; i < prog.GetSize(); ++i) {
-      for (size_t k = 0; k < prog[i].GetSize(); ++k) {
-        inst_seq.emplace_back(prog[i][k].id);
-      }
-    }
-    const double ent = emp::ShannonEntropy(inst_seq);
-    if (ent < 0.0) return 0.0;
-    return ent;
+  // Genome traits are cached on the genome (see ComputeGenomeTraits).
+  inst_ent_fun = [this](agent_t & agent) {
+    if (!agent.GetGenome().traits.valid) this->ComputeGenomeTraits(agent.GetGenome());
+    return agent.GetGenome().traits.inst_entropy;
   };
   
+  // NOTE: only meaningful right after a serial evaluation (i.e., on evaluation context 0).
   func_used_fun = [this](agent_t & agent) {
-    return (int)functions_used.size();
+    return (int)eval_contexts[0]->functions_used.GetUsedCnt();
   };
 
-  func_cnt_fun = [](agent_t & agent) {
-    return (int)agent.GetProgram().GetSize();
+  func_cnt_fun = [this](agent_t & agent) {
+    if (!agent.GetGenome().traits.valid) this->ComputeGenomeTraits(agent.GetGenome());
+    return (int)agent.GetGenome().traits.func_cnt;
   };
 
   get_sim_thresh_fun = [](agent_t & agent) {
@@ -1370,24 +2859,28 @@ void Experiment::DoConfig__Hardware() {
 void Experiment::DoConfig__Evolution() {
   std::cout << "Configure good 'old evolution experiment." << std::endl;
 
-  world->SetPopStruct_Mixed(true);
+  // Parallel reproduction swaps the next generation in itself (see InstallNextGeneration), so the world doesn't
+  // keep a separate next population.
+  world->SetPopStruct_Mixed(REPRODUCTION_THREADS == 0);
   world->SetFitFun([this](agent_t & agent) { return this->GetFitness(agent); });
 
   // Do evaluation!
   do_evaluation_sig.AddAction([this]() {
     best_score = MIN_POSSIBLE_SCORE;
     dom_agent_id = 0;
+    // Evaluate!
+    this->EvaluatePopulation();
     for (size_t id = 0; id < world->GetSize(); ++id) {
-      // Load and configure the agent.
-      agent_t & our_hero = world->GetOrg(id);
-      our_hero.SetID(id);
-      // Evaluate!
-      this->Evaluate(our_hero);
       // Grab the score!
-      double score = GetFitness(our_hero);
+      double score = GetFitness(world->GetOrg(id));
       if (score > best_score) { best_score = score; dom_agent_id = id; }
     }
-    std::cout << "Update: " << update << " Max score: " << best_score << std::endl;
+    std::cout << "Update: " << update << " Max score: " << best_score;
+    if (EVAL_DEDUPLICATE) {
+      std::cout << " Unique genomes: " << eval_ids.size() << "/" << world->GetSize()
+                << " Evaluations saved: " << world->GetSize() - eval_ids.size();
+    }
+    std::cout << std::endl;
   });
 
   do_begin_run_setup_sig.AddAction([this]() {
@@ -1395,15 +2888,23 @@ void Experiment::DoConfig__Evolution() {
   });
 
   // This assumes that this config function gets called after the general experiment config function.
-  do_world_update_sig.AddAction([this]() {
-    world->DoMutations(ELITE_SELECT__ELITE_CNT);
-  });
+  if (REPRODUCTION_THREADS) {
+    do_world_update_sig.AddAction([this]() { this->InstallNextGeneration(); });
+  } else {
+    do_world_update_sig.AddAction([this]() {
+      world->DoMutations(ELITE_SELECT__ELITE_CNT);
+    });
+  }
 
   do_pop_snapshot_sig.AddAction([this](size_t u) { this->Snapshot__Dominant(u); });
 
   // Setup selection
   switch (SELECTION_METHOD) {
     case SELECTION_METHOD_ID__TOURNAMENT: {
+      if (REPRODUCTION_THREADS) {
+        do_selection_sig.AddAction([this]() { this->Reproduce(); });
+        break;
+      }
       do_selection_sig.AddAction([this]() {
         emp::EliteSelect(*world, ELITE_SELECT__ELITE_CNT, 1);
         emp::TournamentSelect(*world, TOURNAMENT_SIZE, POP_SIZE - ELITE_SELECT__ELITE_CNT);
@@ -1424,55 +2925,88 @@ void Experiment::DoConfig__MAPElites() {
   world->SetCache(true);
   world->SetAutoMutate();
   // NOTE: i may need to set mutate on birth to be true!
-  world->SetFitFun([this](agent_t & agent) {
-    const size_t id = 0;
-    agent.SetID(id);
-    // Evaluate!
-    this->Evaluate(agent);
-    // Grab score
-    const double score = this->GetFitness(agent);
-    if (score > best_score) { best_score = score; dom_agent_id = id; }
-    return score;
-  });
+  if (UseSparseMapArchive()) {
+    // Archived agents get evaluated as they're archived (see ArchiveMapOffspring).
+    world->SetFitFun([this](agent_t & agent) { return this->GetFitness(agent); });
+  } else {
+    world->SetFitFun([this](agent_t & agent) {
+      const size_t id = 0;
+      agent.SetID(id);
+      // Evaluate! (Every agent shares phenotype slot 0, so key random number streams by evaluation order.)
+      this->Evaluate(*eval_contexts[0], agent, update_eval_cnt++);
+      // Grab score
+      const double score = this->GetFitness(agent);
+      if (score > best_score) { best_score = score; dom_agent_id = id; }
+      return score;
+    });
+  }
 
+  // Batched mode bins evaluated agents itself: functions used come from the agent's phenotype (last trial), the
+  // same value func_used_fun reads off evaluation context 0 after a serial evaluation.
+  std::function<double(agent_t &)> phen_func_used_fun = [this](agent_t & agent) {
+    return (double)phen_cache.Get(agent.GetID(), TRIAL_CNT - 1).GetFunctionsUsed();
+  };
   emp::vector<size_t> trait_bin_sizes;
   if (MAP_ELITES_AXIS__INST_ENTROPY) {
     std::cout << "Configuring instruction entropy axis" << std::endl;
     world->AddPhenotype("InstEntropy", inst_ent_fun, 0.0, max_inst_entropy + 0.1);
     trait_bin_sizes.emplace_back(MAP_ELITES_AXIS_RES__INST_ENTROPY);
+    map_axes.emplace_back(inst_ent_fun, 0.0, max_inst_entropy + 0.1, MAP_ELITES_AXIS_RES__INST_ENTROPY);
   }
   if (MAP_ELITES_AXIS__FUNCTIONS_USED) {
     std::cout << "Configuring functions used axis" << std::endl;
     world->AddPhenotype("FunctionsUsed", func_used_fun, 0, SGP_PROG_MAX_FUNC_CNT+1);
     trait_bin_sizes.emplace_back(SGP_PROG_MAX_FUNC_CNT+1);
+    map_axes.emplace_back(phen_func_used_fun, 0, SGP_PROG_MAX_FUNC_CNT+1, SGP_PROG_MAX_FUNC_CNT+1);
   }
   if (MAP_ELITES_AXIS__FUNCTION_CNT) {
     std::cout << "Configuring function cnt axis" << std::endl;
     world->AddPhenotype("FunctionCnt", func_cnt_fun, SGP_PROG_MIN_FUNC_CNT, SGP_PROG_MAX_FUNC_CNT+1);
     trait_bin_sizes.emplace_back(SGP_PROG_MAX_FUNC_CNT+1);
+    map_axes.emplace_back([this](agent_t & agent) { return (double)this->func_cnt_fun(agent); },
+                          SGP_PROG_MIN_FUNC_CNT, SGP_PROG_MAX_FUNC_CNT+1, SGP_PROG_MAX_FUNC_CNT+1);
   }
   if (MAP_ELITES_AXIS__SIMILARITY_THRESH) {
     std::cout << "Configuring similarity threshold axis" << std::endl;
     world->AddPhenotype("SimilarityThreshold", get_sim_thresh_fun, MIN_SIM_THRESH, MAX_SIM_THRESH+0.01);
     trait_bin_sizes.emplace_back(MAP_ELITES_AXIS_RES__SIMILARITY_THRESH);
+    map_axes.emplace_back(get_sim_thresh_fun, MIN_SIM_THRESH, MAX_SIM_THRESH+0.01, MAP_ELITES_AXIS_RES__SIMILARITY_THRESH);
   }
 
   max_pop_size = 1;
   for (size_t i = 0; i < trait_bin_sizes.size(); ++i) max_pop_size *= trait_bin_sizes[i];
 
-  std::cout << "Updated max world size: " << max_pop_size << std::endl;
-  phen_cache.Resize(max_pop_size, TRIAL_CNT);
-
-  emp::SetMapElites(*world, trait_bin_sizes);
+  if (UseSparseMapArchive()) {
+    // The world only holds occupied cells (see MapArchive); phenotype storage starts with the offspring slots of
+    // a single batch and grows as cells fill up (see ReserveMapSlots).
+    std::cout << "MAP-Elites grid cells: " << max_pop_size << " (sparse archive)" << std::endl;
+    phen_cache.Resize(MAP_ELITES_BATCH_SIZE, TRIAL_CNT);
+  } else {
+    std::cout << "Updated max world size: " << max_pop_size << std::endl;
+    phen_cache.Resize(max_pop_size, TRIAL_CNT);
+    emp::SetMapElites(*world, trait_bin_sizes);
+  }
 
   do_evaluation_sig.AddAction([this]() {
     best_score = MIN_POSSIBLE_SCORE;
+    update_eval_cnt = 0;
   });
   
-  do_selection_sig.AddAction([this]() {
-    emp::RandomSelect(*world, POP_SIZE);
-    std::cout << "Update: " << update << " Best score (from this update): " << best_score << std::endl;
-  });
+  if (UseSparseMapArchive()) {
+    std::cout << "MAP-Elites batch size: " << MAP_ELITES_BATCH_SIZE << std::endl;
+    do_selection_sig.AddAction([this]() {
+      for (size_t done = 0; done < POP_SIZE; done += MAP_ELITES_BATCH_SIZE) {
+        this->DoMapElitesBatch(emp::Min(MAP_ELITES_BATCH_SIZE, POP_SIZE - done));
+      }
+      std::cout << "Update: " << update << " Best score (from this update): " << best_score
+                << " Archive: " << map_archive.GetSize() << " cells" << std::endl;
+    });
+  } else {
+    do_selection_sig.AddAction([this]() {
+      emp::RandomSelect(*world, POP_SIZE);
+      std::cout << "Update: " << update << " Best score (from this update): " << best_score << std::endl;
+    });
+  }
 
   do_world_update_sig.AddAction([this]() {
     world->ClearCache();
@@ -1493,20 +3027,13 @@ void Experiment::DoConfig__Experiment() {
     return this->mutate_agent(agent, rnd);
   });
 
-  eval_hw->OnBeforeFuncCall([this](hardware_t & hw, size_t fID) {
-    functions_used.emplace(fID);
-  });
-  eval_hw->OnBeforeCoreSpawn([this](hardware_t & hw, size_t fID) {
-    functions_used.emplace(fID);
-  });
-
   // Configure score.
   //  - If tasks: 
   //  - else: 
   if (TASKS_ON) {
-    calc_score = [this](agent_t & agent) {
+    calc_score = [this](eval_ctx_t & ctx, agent_t & agent) {
       double score = 0;
-      phenotype_t & phen = phen_cache.Get(agent.GetID(), trial_id);
+      phenotype_t phen = phen_cache.Get(agent.GetID(), ctx.trial_id);
       score += phen.GetUniqueTasksCompleted();
       score += phen.GetUniqueTasksCredited();
       if (phen.GetTimeAllTasksCredited()) {
@@ -1516,25 +3043,15 @@ void Experiment::DoConfig__Experiment() {
       return score;
     };
   } else {
-    calc_score = [this](agent_t & agent) {
-      return phen_cache.Get(agent.GetID(), trial_id).GetEnvMatchScore();
+    calc_score = [this](eval_ctx_t & ctx, agent_t & agent) {
+      return phen_cache.Get(agent.GetID(), ctx.trial_id).GetEnvMatchScore();
     };
   }
 
-  // Configure mutations
-  if (EVOLVE_SIMILARITY_THRESH) {
-    mutate_agent = [this](agent_t & agent, emp::Random & rnd) {
-      program_t & program = agent.GetProgram();
-      size_t mut_cnt = mutator.ApplyMutations(program, rnd);
-      mut_cnt += this->MutateSimilarityThresh(agent, rnd);
-      return mut_cnt;
-    };
-  } else {
-    mutate_agent = [this](agent_t & agent, emp::Random & rnd) {
-      program_t & program = agent.GetProgram();
-      return mutator.ApplyMutations(program, rnd);
-    };
-  }
+  // Configure mutations (serial mutation uses mutation context 0).
+  mutate_agent = [this](agent_t & agent, emp::Random & rnd) {
+    return this->MutateAgent(agent, rnd, *mut_contexts[0]);
+  };
 
   // Population initialization!
   switch (POP_INIT_METHOD) {
@@ -1563,7 +3080,11 @@ void Experiment::DoConfig__Experiment() {
 
   // - Do world update
   do_world_update_sig.AddAction([this]() {
-    if (update % POP_SNAPSHOT_INTERVAL == 0) do_pop_snapshot_sig.Trigger(update);
+    if (update % POP_SNAPSHOT_INTERVAL == 0) {
+      const auto snapshot_start = std::chrono::steady_clock::now();
+      do_pop_snapshot_sig.Trigger(update);
+      snapshot_time += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - snapshot_start).count();
+    }
     world->Update(); 
   });
 
@@ -1571,11 +3092,7 @@ void Experiment::DoConfig__Experiment() {
   do_begin_run_setup_sig.AddAction([this]() {
     std::cout << "Doing initial run setup." << std::endl;
     // Setup phenotype task counts to match actual task counts.
-    for (size_t aID = 0; aID < max_pop_size; ++aID) {
-      for (size_t tID = 0; tID < TRIAL_CNT; ++tID) {
-        phen_cache.Get(aID, tID).SetTaskCnt(task_set.GetSize());
-      }
-    }
+    phen_cache.SetTaskCnt(task_set.GetSize());
     // Setup systematics/fitness tracking.
     // TODO: ask Emily about issue with setting up systematics file
     // auto & sys_file = world->SetupSystematicsFile("default_systematics", DATA_DIRECTORY + "systematics.csv");
@@ -1586,144 +3103,505 @@ void Experiment::DoConfig__Experiment() {
   });
 
   // - Begin agent eval signal
-  begin_agent_eval_sig.AddAction([this](agent_t & agent) {
-    eval_hw->SetProgram(agent.GetProgram());
+  begin_agent_eval_sig.AddAction([this](eval_ctx_t & ctx, agent_t & agent) {
+    const genome_t & genome = agent.GetGenome();
+    if (genome.unpacked) {
+      ctx.hw->SetProgram(*genome.unpacked);
+    } else {
+      this->UnpackProgram(genome.GetProgram(), *ctx.program);
+      ctx.hw->SetProgram(*ctx.program);
+    }
+    // Bindings are normally built when the genome is created/mutated.
+    if (!agent.GetGenome().IsPrepared()) this->PrepareGenome(agent.GetGenome());
   });
 
   if (EVOLVE_SIMILARITY_THRESH) {
     // Set similarity threshold on eval hardware at beginning of evaluation.
-    begin_agent_eval_sig.AddAction([this](agent_t & agent) {
-      eval_hw->SetMinBindThresh(agent.GetSimilarityThreshold());
+    begin_agent_eval_sig.AddAction([this](eval_ctx_t & ctx, agent_t & agent) {
+      ctx.hw->SetMinBindThresh(agent.GetSimilarityThreshold());
     });
   }
 
-  end_agent_eval_sig.AddAction([this](agent_t & agent) {
+  end_agent_eval_sig.AddAction([this](eval_ctx_t & ctx, agent_t & agent) {
     phen_cache.SetRepresentativeEval(agent.GetID());
   });
 
   // - Begin trial info!
-  begin_agent_trial_sig.AddAction([this](agent_t & agent) {
+  if (EVAL_RNG_MODE == EVAL_RNG_MODE_ID__TRIAL_STREAMS) {
+    // Give every trial its own random number stream (must happen before anything else draws a random number).
+    begin_agent_trial_sig.AddAction([this](eval_ctx_t & ctx, agent_t & agent) {
+      ctx.random->ResetSeed(GetStreamSeed(stream_seed, update, ctx.stream_agent_id, ctx.stream_trial_id));
+    });
+  }
+  begin_agent_trial_sig.AddAction([this](eval_ctx_t & ctx, agent_t & agent) {
     // 1) reset environment state
-    env_state = (size_t)-1;
+    ctx.env_state = (size_t)-1;
     // 2) Reset tasks. 
-    this->ResetTasks();
-    input_load_id = 0;
+    if (ENVIRONMENT_COMMON_SCHEDULES) this->BeginEnvSchedule(ctx);
+    else this->ResetTasks(ctx);
+    ctx.input_load_id = 0;
     // 3) Reset hardware.
-    functions_used.clear();
-    eval_hw->ResetHardware();
-    eval_hw->SetTrait(TRAIT_ID__STATE, -1);
+    ctx.functions_used.Clear();
+    ctx.hw->ResetHardware();
+    ctx.hw->SetTrait(TRAIT_ID__STATE, -1);
+    ctx.hw->SetTrait(TRAIT_ID__EVAL_CTX, ctx.ctx_id);
     // 4) Reset phenotype
-    phen_cache.Get(agent.GetID(), trial_id).Reset();
+    phen_cache.Get(agent.GetID(), ctx.trial_id).Reset();
     // For now, not spawning a core... 
   });
 
-  do_agent_trial_sig.AddAction([this](agent_t & agent) {
-    for (trial_time = 0; trial_time < EVAL_TIME; ++trial_time) {
-      // 1) Advance environment.
-      do_env_advance_sig.Trigger();
-      // 2) Advance agent.
-      do_agent_advance_sig.Trigger(agent);
-    }
-  });
+  if (EVAL_IDLE_FAST_FORWARD && !ENVIRONMENT_COMMON_SCHEDULES) {
+    std::cout << "Idle fast-forward (EVAL_IDLE_FAST_FORWARD) requires ENVIRONMENT_COMMON_SCHEDULES. Exiting..." << std::endl;
+    exit(-1);
+  }
+  if (!EVAL_SIGNAL_HOOKS) {
+    // Fast path: trial loop specialized for this configuration.
+    trial_runner = (SGP_ENVIRONMENT_SIGNALS) ? GetTrialRunner<true>() : GetTrialRunner<false>();
+    do_agent_trial_sig.AddAction([this](eval_ctx_t & ctx, agent_t & agent) {
+      (this->*trial_runner)(ctx, agent);
+    });
+  } else if (EVAL_IDLE_FAST_FORWARD) {
+    // Slow path: advance environment/agent through do_env_advance_sig/do_agent_advance_sig every step.
+    do_agent_trial_sig.AddAction([this](eval_ctx_t & ctx, agent_t & agent) {
+      for (ctx.trial_time = 0; ctx.trial_time < EVAL_TIME; ++ctx.trial_time) {
+        // 1) Advance environment.
+        do_env_advance_sig.Trigger(ctx);
+        // 2) Advance agent.
+        do_agent_advance_sig.Trigger(ctx, agent);
+        // 3) Idle hardware can't do anything until the next environment event: skip ahead.
+        if (ctx.hw->GetActiveCores().size() || ctx.hw->GetEventQueue().size()) continue;
+        const size_t next_time = this->GetNextEnvEventTime(ctx);
+        const size_t skipped = next_time - ctx.trial_time - 1;
+        if (skipped && (size_t)ctx.hw->GetTrait(TRAIT_ID__STATE) == ctx.env_state) {
+          phen_cache.Get(agent.GetID(), ctx.trial_id).IncEnvMatchScore(skipped);
+        }
+        ctx.trial_time = next_time - 1;
+      }
+    });
+  } else {
+    // Slow path: advance environment/agent through do_env_advance_sig/do_agent_advance_sig every step.
+    do_agent_trial_sig.AddAction([this](eval_ctx_t & ctx, agent_t & agent) {
+      for (ctx.trial_time = 0; ctx.trial_time < EVAL_TIME; ++ctx.trial_time) {
+        // 1) Advance environment.
+        do_env_advance_sig.Trigger(ctx);
+        // 2) Advance agent.
+        do_agent_advance_sig.Trigger(ctx, agent);
+      }
+    });
+  }
   
-  end_agent_trial_sig.AddAction([this](agent_t & agent) {
-    const size_t agent_id = agent.GetID();
-    phenotype_t & phen = phen_cache.Get(agent_id, trial_id);
+  end_agent_trial_sig.AddAction([this](eval_ctx_t & ctx, agent_t & agent) {
     // Record everything that must be recorded post-trial
-    phen.SetFunctionsUsed(this->func_used_fun(agent));
-    phen.SetFunctionCnt(this->func_cnt_fun(agent));
-    phen.SetInstEntropy(this->inst_ent_fun(agent));
-    phen.SetSimilarityThreshold(agent.GetSimilarityThreshold());
-    phen.SetTimeAllTasksCredited(task_set.GetAllTasksCreditedTime());
-    phen.SetUniqueTasksCompleted(task_set.GetUniqueTasksCompleted());
-    phen.SetUniqueTasksCredited(task_set.GetUniqueTasksCredited());
-    phen.SetTotalWastedCompletions(task_set.GetTotalTasksWasted());
-    for (size_t taskID = 0; taskID < task_set.GetSize(); ++taskID) {
-      phen.SetCredited(taskID, task_set.GetTask(taskID).GetCreditedCnt());
-      phen.SetCompleted(taskID, task_set.GetTask(taskID).GetCompletionCnt());
-      phen.SetWastedCompletions(taskID, task_set.GetTask(taskID).GetWastedCompletionsCnt());
-    }
-    phen.SetScore(calc_score(agent));
+    this->RecordTrial(ctx, agent, ctx.task_set, ctx.functions_used.GetUsedCnt());
   });
 
-  do_agent_advance_sig.AddAction([this](agent_t & agent) {
+  do_agent_advance_sig.AddAction([this](eval_ctx_t & ctx, agent_t & agent) {
     const size_t agent_id = agent.GetID();
-    eval_hw->SingleProcess();
-    if ((size_t)eval_hw->GetTrait(TRAIT_ID__STATE) == env_state) {
-      phen_cache.Get(agent_id, trial_id).IncEnvMatchScore();
+    ctx.hw->SingleProcess();
+    if ((size_t)ctx.hw->GetTrait(TRAIT_ID__STATE) == ctx.env_state) {
+      phen_cache.Get(agent_id, ctx.trial_id).IncEnvMatchScore();
     }
   });
 
-  switch(ENVIRONMENT_CHANGE_METHOD) {
-    case ENV_CHG_METHOD_ID__RANDOM: {
-      do_env_advance_sig.AddAction([this]() {
-        if (env_state == (size_t)-1 || random->P(ENVIRONMENT_CHANGE_PROB)) {
-          // Trigger change!
-          // 1) Change the environment to a random state.
-          env_state = random->GetUInt(ENVIRONMENT_STATES);
-          // 2) Trigger environment state event.
-          eval_hw->TriggerEvent("EnvSignal", env_state_tags[env_state]);
-        }
-      });
-      break;
+  if (ENVIRONMENT_COMMON_SCHEDULES) {
+    switch(ENVIRONMENT_CHANGE_METHOD) {
+      case ENV_CHG_METHOD_ID__RANDOM:
+      case ENV_CHG_METHOD_ID__SHUFFLED:
+      case ENV_CHG_METHOD_ID__REGULAR: break;
+      default: {
+        std::cout << "Unrecognized environment change method. Exiting..." << std::endl;
+        exit(-1);
+      }
     }
-    case ENV_CHG_METHOD_ID__SHUFFLED: {
-      do_env_advance_sig.AddAction([this]() {
-        if (env_state == (size_t)-1 || random->P(ENVIRONMENT_CHANGE_PROB)) {
+    // Generate this update's environment schedules before anyone gets evaluated.
+    do_evaluation_sig.AddAction([this]() { this->GenerateEnvSchedules(); });
+    // Replay the current trial's environment schedule.
+    do_env_advance_sig.AddAction([this](eval_ctx_t & ctx) {
+      const env_schedule_t & sched = *ctx.env_schedule;
+      while (ctx.env_event_id < sched.events.size() && sched.events[ctx.env_event_id].time == ctx.trial_time) {
+        const env_schedule_t::Event & event = sched.events[ctx.env_event_id];
+        if (event.is_distraction) {
+          ctx.hw->TriggerEvent("EnvSignal", distraction_sig_tags[event.tag_id]);
+        } else {
+          ctx.env_state = event.tag_id;
+          ctx.hw->TriggerEvent("EnvSignal", env_state_tags[ctx.env_state]);
+        }
+        ++ctx.env_event_id;
+      }
+    });
+  } else {
+    switch(ENVIRONMENT_CHANGE_METHOD) {
+      case ENV_CHG_METHOD_ID__RANDOM: {
+        do_env_advance_sig.AddAction([this](eval_ctx_t & ctx) {
+          if (ctx.env_state == (size_t)-1 || ctx.random->P(ENVIRONMENT_CHANGE_PROB)) {
+            // Trigger change!
+            // 1) Change the environment to a random state.
+            ctx.env_state = ctx.random->GetUInt(ENVIRONMENT_STATES);
+            // 2) Trigger environment state event.
+            ctx.hw->TriggerEvent("EnvSignal", env_state_tags[ctx.env_state]);
+          }
+        });
+        break;
+      }
+      case ENV_CHG_METHOD_ID__SHUFFLED: {
+        do_env_advance_sig.AddAction([this](eval_ctx_t & ctx) {
+          if (ctx.env_state == (size_t)-1 || ctx.random->P(ENVIRONMENT_CHANGE_PROB)) {
           
-          // What state should we switch to?
-          env_state = env_shuffler[env_shuffle_id]; 
-          env_shuffle_id += 1;
+            // What state should we switch to?
+            ctx.env_state = ctx.env_shuffler[ctx.env_shuffle_id]; 
+            ctx.env_shuffle_id += 1;
 
-          // std::cout << "Environment changes to: " << env_state << std::endl;
+            // std::cout << "Environment changes to: " << ctx.env_state << std::endl;
 
-          // If shuffle id exceeds env states, reset to 0 and shuffle!
-          if (env_shuffle_id >= ENVIRONMENT_STATES) {
-            env_shuffle_id = 0;
-            emp::Shuffle(*random, env_shuffler);
-            // std::cout << "---SHUFFLE TRIGGERED---" << std::endl;
+            // If shuffle id exceeds env states, reset to 0 and shuffle!
+            if (ctx.env_shuffle_id >= ENVIRONMENT_STATES) {
+              ctx.env_shuffle_id = 0;
+              emp::Shuffle(*ctx.random, ctx.env_shuffler);
+              // std::cout << "---SHUFFLE TRIGGERED---" << std::endl;
+            }
+
+            // Trigger environment state event.
+            ctx.hw->TriggerEvent("EnvSignal", env_state_tags[ctx.env_state]);
+          }
+        });
+        begin_agent_trial_sig.AddAction([this](eval_ctx_t & ctx, agent_t & agent) {
+          ctx.env_shuffle_id = 0;
+          emp::Shuffle(*ctx.random, ctx.env_shuffler);
+        });
+      }
+      case ENV_CHG_METHOD_ID__REGULAR: {
+        do_env_advance_sig.AddAction([this](eval_ctx_t & ctx) {
+          if (ctx.env_state == (size_t)-1 || ((ctx.trial_time % ENVIRONMENT_CHANGE_INTERVAL) == 0)) {
+            // Trigger change!
+            // 1) Change the environment to a random state.
+            ctx.env_state = ctx.random->GetUInt(ENVIRONMENT_STATES);
+            // 2) Trigger environment state event.
+            ctx.hw->TriggerEvent("EnvSignal", env_state_tags[ctx.env_state]);
           }
+        });
+        break;
+      }
+      default: {
+        std::cout << "Unrecognized environment change method. Exiting..." << std::endl;
+        exit(-1);
+      }
+    }
 
-          // Trigger environment state event.
-          eval_hw->TriggerEvent("EnvSignal", env_state_tags[env_state]);
+    // If distraction signals...
+    if (ENVIRONMENT_DISTRACTION_SIGNALS) {
+      do_env_advance_sig.AddAction([this](eval_ctx_t & ctx) {
+        if (ctx.random->P(ENVIRONMENT_DISTRACTION_SIGNAL_PROB)) {
+          const size_t id = ctx.random->GetUInt(distraction_sig_tags.size());
+          ctx.hw->TriggerEvent("EnvSignal", distraction_sig_tags[id]);
         }
       });
-      begin_agent_trial_sig.AddAction([this](agent_t & agent) {
-        env_shuffle_id = 0;
-        emp::Shuffle(*random, env_shuffler);
-      });
+    }
+  }
+}
+
+/// Pick the trial loop instantiation that matches this run's environment configuration.
+template<bool ENV_SIGNALS>
+Experiment::trial_runner_t Experiment::GetTrialRunner() {
+  if (ENVIRONMENT_COMMON_SCHEDULES) {
+    if (EVAL_IDLE_FAST_FORWARD) return &Experiment::RunTrial__Schedule<ENV_SIGNALS, true>;
+    return &Experiment::RunTrial__Schedule<ENV_SIGNALS, false>;
+  }
+  switch (ENVIRONMENT_CHANGE_METHOD) {
+    case ENV_CHG_METHOD_ID__RANDOM: {
+      if (ENVIRONMENT_DISTRACTION_SIGNALS) return &Experiment::RunTrial__Live<ENV_SIGNALS, ENV_CHG_METHOD_ID__RANDOM, true>;
+      return &Experiment::RunTrial__Live<ENV_SIGNALS, ENV_CHG_METHOD_ID__RANDOM, false>;
+    }
+    case ENV_CHG_METHOD_ID__SHUFFLED: {
+      if (ENVIRONMENT_DISTRACTION_SIGNALS) return &Experiment::RunTrial__Live<ENV_SIGNALS, ENV_CHG_METHOD_ID__SHUFFLED, true>;
+      return &Experiment::RunTrial__Live<ENV_SIGNALS, ENV_CHG_METHOD_ID__SHUFFLED, false>;
     }
     case ENV_CHG_METHOD_ID__REGULAR: {
-      do_env_advance_sig.AddAction([this]() {
-        if (env_state == (size_t)-1 || ((trial_time % ENVIRONMENT_CHANGE_INTERVAL) == 0)) {
-          // Trigger change!
-          // 1) Change the environment to a random state.
-          env_state = random->GetUInt(ENVIRONMENT_STATES);
-          // 2) Trigger environment state event.
-          eval_hw->TriggerEvent("EnvSignal", env_state_tags[env_state]);
-        }
-      });
-      break;
+      if (ENVIRONMENT_DISTRACTION_SIGNALS) return &Experiment::RunTrial__Live<ENV_SIGNALS, ENV_CHG_METHOD_ID__REGULAR, true>;
+      return &Experiment::RunTrial__Live<ENV_SIGNALS, ENV_CHG_METHOD_ID__REGULAR, false>;
     }
     default: {
       std::cout << "Unrecognized environment change method. Exiting..." << std::endl;
       exit(-1);
     }
   }
+}
 
-  // If distraction signals...
-  if (ENVIRONMENT_DISTRACTION_SIGNALS) {
-    do_env_advance_sig.AddAction([this]() {
-      if (random->P(ENVIRONMENT_DISTRACTION_SIGNAL_PROB)) {
-        const size_t id = random->GetUInt(distraction_sig_tags.size());
-        eval_hw->TriggerEvent("EnvSignal", distraction_sig_tags[id]);
+void Experiment::DoConfig__Analysis() {
+  switch (ANALYSIS_METHOD) {
+    case ANALYSIS_METHOD_ID__EVAL_BENCHMARK: {
+      if (!UseLockstepHardware() || !ENVIRONMENT_COMMON_SCHEDULES) {
+        std::cout << "Evaluation benchmark requires lockstep hardware (EVAL_BATCH_SIZE > 1 or EVAL_FLAT_HARDWARE) and ENVIRONMENT_COMMON_SCHEDULES. Exiting..." << std::endl;
+        exit(-1);
       }
-    });
+      DoConfig__Experiment();
+      do_analysis_sig.AddAction([this]() { this->Analysis__EvalBenchmark(); });
+      break;
+    }
+    case ANALYSIS_METHOD_ID__DISPATCH_BENCHMARK: {
+      do_analysis_sig.AddAction([this]() { this->Analysis__DispatchBenchmark(); });
+      break;
+    }
+    case ANALYSIS_METHOD_ID__LOCKSTEP_EQUIVALENCE: {
+      if (!UseLockstepHardware() || !ENVIRONMENT_COMMON_SCHEDULES) {
+        std::cout << "Lockstep equivalence analysis requires lockstep hardware (EVAL_BATCH_SIZE > 1 or EVAL_FLAT_HARDWARE) and ENVIRONMENT_COMMON_SCHEDULES. Exiting..." << std::endl;
+        exit(-1);
+      }
+      DoConfig__Experiment();
+      do_analysis_sig.AddAction([this]() { this->Analysis__LockstepEquivalence(); });
+      break;
+    }
+    case ANALYSIS_METHOD_ID__HARDWARE_TRAJECTORY: {
+      if (!UseLockstepHardware() || !ENVIRONMENT_COMMON_SCHEDULES) {
+        std::cout << "Hardware trajectory check requires lockstep hardware (EVAL_BATCH_SIZE > 1 or EVAL_FLAT_HARDWARE) and ENVIRONMENT_COMMON_SCHEDULES. Exiting..." << std::endl;
+        exit(-1);
+      }
+      DoConfig__Experiment();
+      DoConfig__Evolution();
+      do_analysis_sig.AddAction([this]() { this->Analysis__HardwareTrajectory(); });
+      break;
+    }
+    default: {
+      std::cout << "Unrecognized analysis method (" << ANALYSIS_METHOD << "). Exiting..." << std::endl;
+      exit(-1);
+    }
   }
 }
 
-void Experiment::DoConfig__Analysis() {
+// == Analysis functions ==
+/// Evaluate the initial population once on EventDrivenGP hardware and once on lockstep hardware.
+///  - Both evaluations replay the same environment schedules on a single evaluation context.
+///  - Reports agent-timesteps/sec for each and how many (agent, trial) scores disagree. With per-trial
+///    random number streams (EVAL_RNG_MODE=1), the two should agree exactly.
+///  - Heap allocation counts compare the two engines. Only the lockstep hardware pools call states and
+///    signals; EventDrivenGP (Empirical) allocates as it always has.
+void Experiment::Analysis__EvalBenchmark() {
+  phen_cache.SetTaskCnt(task_set.GetSize());
+  do_pop_init_sig.Trigger();
+  GenerateEnvSchedules();
+
+  eval_ctx_t & ctx = *eval_contexts[0];
+  const size_t pop_size = world->GetSize();
+  const double agent_timesteps = (double)(pop_size * TRIAL_CNT * EVAL_TIME);
+  emp::vector<double> edgp_scores(pop_size * TRIAL_CNT, 0.0);
+
+  // 1) EventDrivenGP hardware.
+  size_t allocs = GetHeapAllocCnt();
+  auto start = std::chrono::steady_clock::now();
+  for (size_t id = 0; id < pop_size; ++id) {
+    agent_t & our_hero = world->GetOrg(id);
+    our_hero.SetID(id);
+    Evaluate(ctx, our_hero);
+  }
+  const double edgp_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const size_t edgp_allocs = GetHeapAllocCnt() - allocs;
+  for (size_t id = 0; id < pop_size; ++id) {
+    for (size_t tID = 0; tID < TRIAL_CNT; ++tID) edgp_scores[id * TRIAL_CNT + tID] = phen_cache.Get(id, tID).GetScore();
+  }
+
+  // 2) Lockstep hardware.
+  emp::vector<size_t> ids(pop_size);
+  for (size_t id = 0; id < pop_size; ++id) ids[id] = id;
+  const size_t dropped_before = (ctx.batch_hw) ? ctx.batch_hw->GetDroppedSignalCnt() : 0;
+  allocs = GetHeapAllocCnt();
+  start = std::chrono::steady_clock::now();
+  const size_t lockstep_cnt = EvaluateRange(ctx, ids, 0, pop_size);
+  const double lockstep_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const size_t lockstep_allocs = GetHeapAllocCnt() - allocs;
+  const size_t dropped_signals = ((ctx.batch_hw) ? ctx.batch_hw->GetDroppedSignalCnt() : 0) - dropped_before;
+  size_t mismatches = 0;
+  for (size_t id = 0; id < pop_size; ++id) {
+    for (size_t tID = 0; tID < TRIAL_CNT; ++tID) {
+      if (edgp_scores[id * TRIAL_CNT + tID] != phen_cache.Get(id, tID).GetScore()) ++mismatches;
+    }
+  }
+
+  std::cout << "Agents: " << pop_size << " (" << lockstep_cnt << " ran on lockstep hardware)" << std::endl;
+  std::cout << "EventDrivenGP: " << edgp_secs << "s (" << agent_timesteps / edgp_secs << " agent-timesteps/sec, "
+            << edgp_allocs << " heap allocations)" << std::endl;
+  std::cout << "Lockstep (" << GetLockstepLanes() << " lanes): " << lockstep_secs << "s (" << agent_timesteps / lockstep_secs
+            << " agent-timesteps/sec, " << lockstep_allocs << " heap allocations)" << std::endl;
+  if (!heap_alloc_cnt_fun) std::cout << "(Heap allocations are not counted in this build; build with `make bench` to count them.)" << std::endl;
+  else std::cout << "(Heap allocations compare engines: only the lockstep hardware pools call states and signals.)" << std::endl;
+  std::cout << "Mismatched trial scores: " << mismatches << std::endl;
+  if (dropped_signals) std::cout << "WARNING: lockstep hardware dropped " << dropped_signals << " environment signals (signal queue full)." << std::endl;
+
+  std::ofstream out_fstream(DATA_DIRECTORY + ANALYSIS_OUTPUT_FNAME);
+  out_fstream << "engine,lanes,agents,lockstep_agents,trials,eval_time,seconds,agent_timesteps_per_sec,heap_allocs,mismatched_trials,dropped_signals\n";
+  out_fstream << "edgp,1," << pop_size << ",0," << TRIAL_CNT << "," << EVAL_TIME << ","
+              << edgp_secs << "," << agent_timesteps / edgp_secs << "," << edgp_allocs << ",0,0\n";
+  out_fstream << "lockstep," << GetLockstepLanes() << "," << pop_size << "," << lockstep_cnt << "," << TRIAL_CNT << "," << EVAL_TIME << ","
+              << lockstep_secs << "," << agent_timesteps / lockstep_secs << "," << lockstep_allocs << "," << mismatches << ","
+              << dropped_signals << "\n";
+  out_fstream.close();
+}
+
+/// Per-instruction dispatch microbenchmark: EventDrivenGP (InstLib dispatch) vs. lockstep hardware (plain and fused).
+///  - For every instruction the lockstep hardware understands, runs a single-function program made of copies of
+///    that instruction for TRIAL_CNT * EVAL_TIME timesteps on one core (respawned whenever it finishes).
+///  - Reports nanoseconds per timestep for each engine.
+void Experiment::Analysis__DispatchBenchmark() {
+  constexpr size_t prog_len = 32;
+  eval_ctx_t & ctx = *eval_contexts[0];
+  hardware_t & hw = *ctx.hw;
+  const size_t timesteps = TRIAL_CNT * EVAL_TIME;
+  batch_hw_t batch_hw(1, SGP_HW_MAX_CORES, SGP_HW_MAX_CALL_DEPTH);
+  taskset_t lane_tasks(task_set);
+  TagBindings bindings;
+  bindings.Build(1, 1, 0.0, [](size_t tag_id, size_t fID) { return 1.0; });
+  task_solutions_t sols;
+  DrawTaskInputs(*ctx.random, ctx.task_inputs, sols);
+  ctx.task_set.SetSolutions(sols.data());
+  lane_tasks.SetSolutions(sols.data());
+  ctx.env_state = 0;
+
+  std::ofstream out_fstream(DATA_DIRECTORY + ANALYSIS_OUTPUT_FNAME);
+  out_fstream << "inst,edgp_ns_per_step,lockstep_ns_per_step,lockstep_fused_ns_per_step\n";
+  for (size_t instID = 0; instID < inst_lib->GetSize(); ++instID) {
+    if (lockstep_opcodes[instID] < 0) continue;
+    program_t prog(inst_lib);
+    hardware_t::Function fun;
+    for (size_t i = 0; i < prog_len; ++i) fun.PushInst(instID, 0, 1, 2, tag_t());
+    prog.PushFunction(fun);
+
+    // 1) EventDrivenGP hardware.
+    hw.SetProgram(prog);
+    hw.ResetHardware();
+    hw.SetTrait(TRAIT_ID__STATE, -1);
+    hw.SetTrait(TRAIT_ID__EVAL_CTX, ctx.ctx_id);
+    auto start = std::chrono::steady_clock::now();
+    for (ctx.trial_time = 0; ctx.trial_time < timesteps; ++ctx.trial_time) {
+      if (!hw.GetActiveCores().size()) hw.SpawnCore(0, memory_t(), false);
+      hw.SingleProcess();
+    }
+    const double edgp_ns = 1e9 * std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / timesteps;
+
+    // 2) Lockstep hardware, without and with superinstructions.
+    double lockstep_ns[2] = {0, 0};
+    for (size_t fuse = 0; fuse < 2; ++fuse) {
+      batch_program_t batch_prog;
+      DecodeProgram(*PackProgram(prog), batch_prog, fuse);
+      batch_hw.SetLane(0, &batch_prog, &bindings, SGP_HW_MIN_BIND_THRESH, ctx.random, &lane_tasks);
+      batch_hw.ResetLane(0);
+      batch_hw.SetTaskInputs(ctx.task_inputs);
+      start = std::chrono::steady_clock::now();
+      for (size_t t = 0; t < timesteps; ++t) {
+        if (batch_hw.IsIdle(1)) batch_hw.QueueSignal(0);
+        batch_hw.SetEnvironment(ctx.env_state, t);
+        batch_hw.Step(1);
+      }
+      lockstep_ns[fuse] = 1e9 * std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / timesteps;
+    }
+
+    std::cout << inst_lib->GetName(instID) << ": EventDrivenGP " << edgp_ns << "ns, lockstep " << lockstep_ns[0]
+              << "ns, lockstep (fused) " << lockstep_ns[1] << "ns" << std::endl;
+    out_fstream << inst_lib->GetName(instID) << "," << edgp_ns << "," << lockstep_ns[0] << "," << lockstep_ns[1] << "\n";
+  }
+  out_fstream.close();
+}
+
+/// Check that every way of running the initial population agrees, trial by trial:
+///  - EventDrivenGP hardware, lockstep hardware without superinstructions, and lockstep hardware running fused
+///    programs.
+///  - EventDrivenGP results only match lockstep results exactly with per-trial random number streams (EVAL_RNG_MODE=1).
+void Experiment::Analysis__LockstepEquivalence() {
+  phen_cache.SetTaskCnt(task_set.GetSize());
+  do_pop_init_sig.Trigger();
+  GenerateEnvSchedules();
+
+  eval_ctx_t & ctx = *eval_contexts[0];
+  const size_t pop_size = world->GetSize();
+  emp::vector<size_t> ids(pop_size);
+  for (size_t id = 0; id < pop_size; ++id) ids[id] = id;
+  // Per-engine scores: [engine][agent * TRIAL_CNT + trial]
+  emp::vector<emp::vector<double>> scores(3, emp::vector<double>(pop_size * TRIAL_CNT, 0.0));
+  auto record_scores = [this, pop_size](emp::vector<double> & out) {
+    for (size_t id = 0; id < pop_size; ++id) {
+      for (size_t tID = 0; tID < TRIAL_CNT; ++tID) out[id * TRIAL_CNT + tID] = phen_cache.Get(id, tID).GetScore();
+    }
+  };
 
+  // 1) EventDrivenGP hardware.
+  for (size_t id = 0; id < pop_size; ++id) {
+    agent_t & our_hero = world->GetOrg(id);
+    our_hero.SetID(id);
+    Evaluate(ctx, our_hero);
+  }
+  record_scores(scores[0]);
+
+  // 2) Lockstep hardware, plain decode.
+  lockstep_fuse = false;
+  const size_t plain_cnt = EvaluateRange(ctx, ids, 0, pop_size);
+  record_scores(scores[1]);
+
+  // 3) Lockstep hardware, fused programs.
+  lockstep_fuse = true;
+  const size_t fused_cnt = EvaluateRange(ctx, ids, 0, pop_size);
+  record_scores(scores[2]);
+
+  size_t edgp_vs_plain = 0;
+  size_t plain_vs_fused = 0;
+  for (size_t i = 0; i < scores[0].size(); ++i) {
+    if (scores[0][i] != scores[1][i]) ++edgp_vs_plain;
+    if (scores[1][i] != scores[2][i]) ++plain_vs_fused;
+  }
+  std::cout << "Agents: " << pop_size << " (" << plain_cnt << " ran on lockstep hardware)" << std::endl;
+  std::cout << "Mismatched trials, EventDrivenGP vs. lockstep: " << edgp_vs_plain << std::endl;
+  std::cout << "Mismatched trials, lockstep vs. fused lockstep: " << plain_vs_fused << std::endl;
+
+  std::ofstream out_fstream(DATA_DIRECTORY + ANALYSIS_OUTPUT_FNAME);
+  out_fstream << "agents,trials,lockstep_agents,fused_lockstep_agents,edgp_vs_lockstep_mismatches,lockstep_vs_fused_mismatches\n";
+  out_fstream << pop_size << "," << TRIAL_CNT << "," << plain_cnt << "," << fused_cnt << ","
+              << edgp_vs_plain << "," << plain_vs_fused << "\n";
+  out_fstream.close();
+}
+
+/// Check that evolution follows the same trajectory on EventDrivenGP hardware and on lockstep (flat register file)
+/// hardware.
+///  - Runs GENERATIONS updates of the evolutionary algorithm twice from the same random number generator state: once
+///    evaluating every agent on EventDrivenGP hardware, once on lockstep hardware.
+///  - Compares every update's max score and population (genome hashes).
+///  - Trajectories only match exactly with per-trial random number streams (EVAL_RNG_MODE=1).
+void Experiment::Analysis__HardwareTrajectory() {
+  phen_cache.SetTaskCnt(task_set.GetSize());
+  const emp::Random start_random(*random);
+  emp::vector<emp::Random> start_ctx_randoms;
+  for (size_t i = 0; i < eval_contexts.size(); ++i) {
+    if (eval_contexts[i]->owns_random) start_ctx_randoms.emplace_back(*eval_contexts[i]->random);
+  }
+  // Per-engine trajectories: [engine][update]
+  emp::vector<emp::vector<double>> max_scores(2);
+  emp::vector<emp::vector<uint64_t>> pop_hashes(2);
+  for (size_t engine = 0; engine < 2; ++engine) {
+    std::cout << "=== Running on " << ((engine) ? "lockstep" : "EventDrivenGP") << " hardware ===" << std::endl;
+    *random = start_random;
+    for (size_t i = 0, k = 0; i < eval_contexts.size(); ++i) {
+      if (eval_contexts[i]->owns_random) *eval_contexts[i]->random = start_ctx_randoms[k++];
+    }
+    lockstep_on = (engine == 1);
+    world->Reset();
+    do_pop_init_sig.Trigger();
+    for (update = 0; update <= GENERATIONS; ++update) {
+      do_evaluation_sig.Trigger();
+      max_scores[engine].emplace_back(best_score);
+      pop_hashes[engine].emplace_back(GetPopulationHash());
+      do_selection_sig.Trigger();
+      do_world_update_sig.Trigger();
+    }
+  }
+  lockstep_on = true;
+
+  size_t mismatches = 0;
+  std::ofstream out_fstream(DATA_DIRECTORY + ANALYSIS_OUTPUT_FNAME);
+  out_fstream << "update,edgp_max_score,lockstep_max_score,edgp_pop_hash,lockstep_pop_hash,match\n";
+  for (size_t u = 0; u < max_scores[0].size(); ++u) {
+    const bool match = max_scores[0][u] == max_scores[1][u] && pop_hashes[0][u] == pop_hashes[1][u];
+    if (!match && !mismatches) std::cout << "Trajectories diverge at update " << u << "." << std::endl;
+    if (!match) ++mismatches;
+    out_fstream << u << "," << max_scores[0][u] << "," << max_scores[1][u] << "," << pop_hashes[0][u] << ","
+                << pop_hashes[1][u] << "," << match << "\n";
+  }
+  out_fstream.close();
+  std::cout << "Mismatched updates, EventDrivenGP vs. lockstep: " << mismatches << "/" << max_scores[0].size() << std::endl;
 }
 
 #endif
@@ -0,0 +1,70 @@
+#ifndef CHG_ENV_FUNCTION_USAGE_H
+#define CHG_ENV_FUNCTION_USAGE_H
+
+#include <array>
+#include <cstdint>
+
+#include "base/assert.h"
+
+/// Tracks which functions of a program were used during a trial (and how many times each was entered).
+///  - Fixed width: supports programs with up to MAX_FUNCS functions.
+///  - Clear only touches the call counts of functions that were actually used.
+template<size_t MAX_FUNCS>
+class FunctionUsage {
+public:
+  static constexpr size_t WORD_CNT = (MAX_FUNCS + 63) / 64;
+
+protected:
+  std::array<uint64_t, WORD_CNT> used;
+  std::array<uint32_t, MAX_FUNCS> call_cnts;
+
+public:
+  FunctionUsage() { used.fill(0); call_cnts.fill(0); }
+
+  static constexpr size_t GetMaxFuncs() { return MAX_FUNCS; }
+
+  void Clear() {
+    for (size_t w = 0; w < WORD_CNT; ++w) {
+      uint64_t bits = used[w];
+      while (bits) {
+        call_cnts[(w * 64) + (size_t)__builtin_ctzll(bits)] = 0;
+        bits &= bits - 1;
+      }
+      used[w] = 0;
+    }
+  }
+
+  /// Record a call to (or core spawned on) the given function.
+  void Mark(size_t fID) {
+    emp_assert(fID < MAX_FUNCS, fID);
+    used[fID >> 6] |= ((uint64_t)1 << (fID & 63));
+    ++call_cnts[fID];
+  }
+
+  bool IsUsed(size_t fID) const { return (used[fID >> 6] >> (fID & 63)) & 1; }
+
+  /// How many distinct functions were used?
+  size_t GetUsedCnt() const {
+    size_t cnt = 0;
+    for (size_t w = 0; w < WORD_CNT; ++w) cnt += (size_t)__builtin_popcountll(used[w]);
+    return cnt;
+  }
+
+  /// How many times was the given function called/spawned?
+  uint32_t GetCallCnt(size_t fID) const { return call_cnts[fID]; }
+  const std::array<uint32_t, MAX_FUNCS> & GetCallCnts() const { return call_cnts; }
+
+  /// Add every used function's call count to cnts[fID] (MAX_FUNCS entries).
+  void AddCallCnts(uint32_t * cnts) const {
+    for (size_t w = 0; w < WORD_CNT; ++w) {
+      uint64_t bits = used[w];
+      while (bits) {
+        const size_t fID = (w * 64) + (size_t)__builtin_ctzll(bits);
+        cnts[fID] += call_cnts[fID];
+        bits &= bits - 1;
+      }
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,752 @@
+#ifndef CHG_ENV_LOCKSTEP_HARDWARE_H
+#define CHG_ENV_LOCKSTEP_HARDWARE_H
+
+#include <string>
+#include <array>
+#include <algorithm>
+#include <cstdint>
+
+#include "base/Ptr.h"
+#include "base/vector.h"
+#include "tools/Random.h"
+
+#include "TagBindings.h"
+#include "FunctionUsage.h"
+
+/// Lockstep batched SignalGP interpreter for the changing environment experiments.
+///  - Holds the hardware state of many agents (lanes) and advances every lane by one timestep at a time.
+///  - All lanes share the environment (state, task inputs, and environment signals).
+///  - Environment signals are dispatched through each lane's precomputed tag bindings.
+///  - Follows emp::EventDrivenGP_AW semantics for this experiment's instruction set.
+///  - Per-lane state is kept in parallel arrays (indexed by lane). Call states live in one frame pool with room for
+///    max_call_depth frames on every core, and environment signals go through a fixed-capacity queue, so spawning
+///    cores, calling functions, queueing signals, and resetting lanes don't allocate. Each core's open-block stack
+///    starts with room for one block per frame and grows to its high-water mark on demand; grown stacks are kept,
+///    so allocation stops once a batch's programs have been run.
+///  - Every trial starts a lane from the same blank image (see ResetLane).
+///  - Local, input, output, and shared memories are flat arrays of MEM_SIZE registers, so instruction
+///    arguments must be in [0, MEM_SIZE).
+///  - Programs may have at most MAX_FUNCS functions (function usage is tracked with a fixed-width bitset).
+///  - Straight-line runs of local instructions (see IsLocalOp) are fused into superinstructions when a program is
+///    finalized: a fused run executes back to back (direct-threaded where supported) and the core then stalls for
+///    the timesteps the run would have taken, so timing and results match unfused execution.
+template<typename TASKSET_T, size_t TAG_WIDTH, size_t MEM_SIZE=16, size_t MAX_FUNCS=128, size_t MAX_SIGNALS=32>
+class LockstepHardware {
+public:
+  static_assert(TAG_WIDTH <= 32, "LockstepHardware stores tags as 32-bit words.");
+  static_assert(MEM_SIZE <= 32, "LockstepHardware tracks written output registers with a 32-bit mask.");
+
+  /// Environment signals that can be queued for a single step. Size it from the environment's per-step upper bound:
+  /// EventDrivenGP never drops events, so a dropped signal makes the two engines diverge.
+  static constexpr size_t MAX_QUEUED_SIGNALS = MAX_SIGNALS;
+
+  using taskset_t = TASKSET_T;
+  using task_io_t = typename taskset_t::task_output_t;
+  using task_inputs_t = typename taskset_t::task_input_t;
+  using tag_t = uint32_t;
+  using mem_t = std::array<double, MEM_SIZE>;
+  using func_usage_t = FunctionUsage<MAX_FUNCS>;
+
+  /// Instructions understood by the lockstep hardware.
+  enum Opcode : uint8_t {
+    OP_INC=0, OP_DEC, OP_NOT, OP_ADD, OP_SUB, OP_MULT, OP_DIV, OP_MOD,
+    OP_TEST_EQU, OP_TEST_NEQU, OP_TEST_LESS,
+    OP_IF, OP_WHILE, OP_COUNTDOWN, OP_CLOSE, OP_BREAK,
+    OP_CALL, OP_RETURN,
+    OP_SET_MEM, OP_COPY_MEM, OP_SWAP_MEM, OP_INPUT, OP_OUTPUT, OP_COMMIT, OP_PULL,
+    OP_NOP, OP_FORK, OP_TERMINATE,
+    OP_LOAD_1, OP_LOAD_2, OP_SUBMIT, OP_NAND,
+    OP_SET_STATE, OP_SENSE_STATE,
+    OP_FUSED,   ///< Superinstruction: args[0] local instructions starting here (imm: index of original head).
+    OP_CNT
+  };
+
+  /// Decoded instruction.
+  struct Inst {
+    uint8_t op;
+    std::array<uint8_t, 3> args;
+    uint32_t imm;   ///< SetState/SenseState: state ID. If/While/Countdown: end of block (function-relative).
+    tag_t tag;
+
+    Inst(uint8_t _op=OP_NOP, uint8_t a0=0, uint8_t a1=0, uint8_t a2=0, uint32_t _imm=0, tag_t _tag=0)
+      : op(_op), args({{a0, a1, a2}}), imm(_imm), tag(_tag) { ; }
+  };
+
+  /// Decoded function: a tag and a slice of the program's code.
+  struct Function {
+    tag_t tag;
+    uint32_t begin;
+    uint32_t len;
+
+    Function(tag_t _tag=0, uint32_t _b=0, uint32_t _l=0) : tag(_tag), begin(_b), len(_l) { ; }
+  };
+
+  /// Decoded program. All functions share one contiguous code array.
+  struct Program {
+    static constexpr size_t MAX_FUSED_LEN = 255;
+
+    emp::vector<Function> functions;
+    emp::vector<Inst> code;
+    emp::vector<Inst> fused_heads;  ///< Original first instruction of every fused run.
+
+    void Clear() { functions.clear(); code.clear(); fused_heads.clear(); }
+    size_t GetSize() const { return functions.size(); }
+
+    /// Append a new (empty) function. Return false if the program already has MAX_FUNCS functions.
+    bool PushFunction(tag_t tag) {
+      if (functions.size() >= MAX_FUNCS) return false;
+      functions.emplace_back(tag, (uint32_t)code.size(), 0);
+      return true;
+    }
+
+    /// Append instruction to last function. Return false if arguments are out of range.
+    bool PushInst(uint8_t op, int a0, int a1, int a2, tag_t tag, uint32_t imm=0) {
+      if (!functions.size()) return false;
+      if (a0 < 0 || a1 < 0 || a2 < 0) return false;
+      if ((size_t)a0 >= MEM_SIZE || (size_t)a1 >= MEM_SIZE || (size_t)a2 >= MEM_SIZE) return false;
+      code.emplace_back(op, (uint8_t)a0, (uint8_t)a1, (uint8_t)a2, imm, tag);
+      ++functions.back().len;
+      return true;
+    }
+
+    /// Precompute where every If/While/Countdown block ends (same search as EventDrivenGP::FindEndOfBlock),
+    /// then (optionally) fuse runs of local instructions into superinstructions.
+    void Finalize(bool fuse=true) {
+      for (size_t fID = 0; fID < functions.size(); ++fID) {
+        const Function & fun = functions[fID];
+        for (size_t ip = 0; ip < fun.len; ++ip) {
+          Inst & inst = code[fun.begin + ip];
+          if (!IsBlockDef(inst.op)) continue;
+          size_t eob = ip + 1;
+          int depth = 1;
+          while (eob < fun.len) {
+            const uint8_t op = code[fun.begin + eob].op;
+            if (IsBlockDef(op)) ++depth;
+            else if (op == OP_CLOSE) { --depth; if (depth == 0) break; }
+            ++eob;
+          }
+          inst.imm = (uint32_t)eob;
+        }
+      }
+      if (fuse) FuseLocalRuns();
+    }
+
+    /// Replace the first instruction of every maximal run (2+) of local instructions with an OP_FUSED superinstruction.
+    ///  - The rest of the run is left in place, so jumps into the middle of a run still execute unfused.
+    void FuseLocalRuns() {
+      fused_heads.clear();
+      for (size_t fID = 0; fID < functions.size(); ++fID) {
+        const Function & fun = functions[fID];
+        size_t ip = 0;
+        while (ip < fun.len) {
+          if (!IsLocalOp(code[fun.begin + ip].op)) { ++ip; continue; }
+          size_t run = 1;
+          while (ip + run < fun.len && run < MAX_FUSED_LEN && IsLocalOp(code[fun.begin + ip + run].op)) ++run;
+          if (run > 1) {
+            fused_heads.emplace_back(code[fun.begin + ip]);
+            code[fun.begin + ip] = Inst(OP_FUSED, (uint8_t)run, 0, 0, (uint32_t)(fused_heads.size() - 1));
+          }
+          ip += run;
+        }
+      }
+    }
+  };
+
+  static bool IsBlockDef(uint8_t op) { return op == OP_IF || op == OP_WHILE || op == OP_COUNTDOWN; }
+
+  /// Does this instruction only touch its own call state (local/input/output memory) and per-trial constants?
+  /// Nothing else (other cores, the environment, tasks) can see its effects before the core's next non-local instruction.
+  static bool IsLocalOp(uint8_t op) {
+    switch (op) {
+      case OP_INC: case OP_DEC: case OP_NOT: case OP_ADD: case OP_SUB: case OP_MULT: case OP_DIV: case OP_MOD:
+      case OP_TEST_EQU: case OP_TEST_NEQU: case OP_TEST_LESS:
+      case OP_SET_MEM: case OP_COPY_MEM: case OP_SWAP_MEM: case OP_INPUT: case OP_OUTPUT:
+      case OP_NOP: case OP_LOAD_2: case OP_NAND:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  /// Look up the opcode (and immediate) for an instruction name from the experiment's instruction library.
+  static bool GetOpcode(const std::string & name, uint8_t & op, uint32_t & imm) {
+    static const std::array<std::string, OP_SET_STATE> names = {{
+      "Inc", "Dec", "Not", "Add", "Sub", "Mult", "Div", "Mod",
+      "TestEqu", "TestNEqu", "TestLess",
+      "If", "While", "Countdown", "Close", "Break",
+      "Call", "Return",
+      "SetMem", "CopyMem", "SwapMem", "Input", "Output", "Commit", "Pull",
+      "Nop", "Fork", "Terminate",
+      "Load-1", "Load-2", "Submit", "Nand"
+    }};
+    imm = 0;
+    for (size_t i = 0; i < names.size(); ++i) {
+      if (names[i] == name) { op = (uint8_t)i; return true; }
+    }
+    const std::string set_state = "SetState-";
+    const std::string sense_state = "SenseState-";
+    if (name.compare(0, set_state.size(), set_state) == 0) {
+      op = OP_SET_STATE;
+      imm = (uint32_t)std::stoul(name.substr(set_state.size()));
+      return true;
+    }
+    if (name.compare(0, sense_state.size(), sense_state) == 0) {
+      op = OP_SENSE_STATE;
+      imm = (uint32_t)std::stoul(name.substr(sense_state.size()));
+      return true;
+    }
+    return false;
+  }
+
+protected:
+  struct Block {
+    uint32_t begin;
+    uint32_t end;
+    bool is_loop;
+
+    Block(uint32_t _b=0, uint32_t _e=0, bool _l=false) : begin(_b), end(_e), is_loop(_l) { ; }
+  };
+
+  /// A single call state.
+  struct Frame {
+    uint32_t fp;
+    uint32_t ip;
+    uint32_t block_base;  ///< Number of open blocks on this core when this frame was pushed.
+    uint32_t out_mask;    ///< Which output registers have been written.
+    mem_t local;
+    mem_t input;
+    mem_t output;
+  };
+
+  /// A core's call stack: its slice of the frame pool. Blocks past block_cnt are retained for reuse.
+  struct Core {
+    Frame * frames;   ///< max_call_depth frames (see frame_pool).
+    size_t depth;
+    emp::vector<Block> blocks;
+    size_t block_cnt;
+    size_t stall;   ///< Timesteps left before the core may execute again (after a fused run).
+
+    Core() : frames(nullptr), depth(0), blocks(), block_cnt(0), stall(0) { ; }
+
+    Frame & Top() { return frames[depth - 1]; }
+    Frame & Push() { return frames[depth++]; }
+
+    void PushBlock(uint32_t begin, uint32_t end, bool is_loop) {
+      if (block_cnt == blocks.size()) blocks.emplace_back();
+      blocks[block_cnt++] = Block(begin, end, is_loop);
+    }
+  };
+
+  size_t lane_cnt;
+  size_t max_cores;
+  size_t max_call_depth;
+  bool stochastic_fun_call;
+
+  // Shared environment.
+  size_t env_state;
+  size_t trial_time;
+  task_inputs_t task_inputs;
+  std::array<uint32_t, MAX_QUEUED_SIGNALS> signal_queue; ///< Environment signals (binding tag IDs) to be handled by every lane on the next step.
+  size_t signal_cnt;
+  size_t dropped_signal_cnt;  ///< Signals dropped because the queue was full.
+
+  // Per-lane state.
+  emp::vector<emp::Ptr<const Program>> lane_prog;
+  emp::vector<double> lane_min_bind;
+  emp::vector<int64_t> lane_state;      ///< Internal state set by SetState instructions (-1: unset).
+  emp::vector<size_t> lane_load_id;
+  emp::vector<emp::Ptr<emp::Random>> lane_random;
+  emp::vector<emp::Ptr<taskset_t>> lane_tasks;
+  emp::vector<emp::Ptr<const TagBindings>> lane_bindings;
+  emp::vector<func_usage_t> lane_funcs_used;
+  emp::vector<double> lane_shared;      ///< [lane * MEM_SIZE + key]
+
+  // Per-lane core bookkeeping ([lane * max_cores + i]).
+  emp::vector<Core> cores;
+  emp::vector<Frame> frame_pool;        ///< [(lane * max_cores + i) * frame_depth + depth]
+  size_t frame_depth;                   ///< Frames per core (max_call_depth, at least 1).
+  emp::vector<uint32_t> active;
+  emp::vector<size_t> active_cnt;
+  emp::vector<uint32_t> inactive;
+  emp::vector<size_t> inactive_cnt;
+  emp::vector<uint32_t> pending;
+  emp::vector<size_t> pending_cnt;
+
+  emp::vector<uint32_t> match_buffer;   ///< Scratch space for function matching.
+  bool is_executing;
+
+  /// State every lane starts a trial in: no running cores, cores handed out from core 0 up, zeroed shared memory,
+  /// unset internal state, and no functions used.
+  ///  - Doesn't depend on the program, so one image (built by SetLaneCnt) serves every lane.
+  struct LaneImage {
+    emp::vector<uint32_t> inactive;
+    mem_t shared;
+    int64_t state;
+    size_t load_id;
+    func_usage_t funcs_used;
+
+    LaneImage() : inactive(), shared(), state(-1), load_id(0), funcs_used() { shared.fill(0.0); }
+  };
+
+  LaneImage reset_image;                ///< Built by SetLaneCnt.
+
+  Core & GetCore(size_t lane, size_t core_id) { return cores[lane * max_cores + core_id]; }
+
+  /// Find function that best matches tag (ties broken randomly). Return -1 if nothing matches.
+  int MatchFunction(size_t lane, tag_t tag, double threshold) {
+    const Program & prog = *lane_prog[lane];
+    match_buffer.clear();
+    for (size_t fID = 0; fID < prog.functions.size(); ++fID) {
+      const size_t mismatches = (size_t)__builtin_popcount(prog.functions[fID].tag ^ tag);
+      const double bind = (double)(TAG_WIDTH - mismatches) / (double)TAG_WIDTH;
+      if (bind == threshold) {
+        match_buffer.emplace_back((uint32_t)fID);
+      } else if (bind > threshold) {
+        match_buffer.clear();
+        match_buffer.emplace_back((uint32_t)fID);
+        threshold = bind;
+      }
+    }
+    if (match_buffer.empty()) return -1;
+    if (match_buffer.size() == 1 || !stochastic_fun_call) return (int)match_buffer[0];
+    return (int)match_buffer[lane_random[lane]->GetUInt(0, match_buffer.size())];
+  }
+
+  /// Spawn a new core running the function that best matches tag. If input is null, input memory is empty.
+  void SpawnCore(size_t lane, tag_t tag, double threshold, const mem_t * input) {
+    if (!inactive_cnt[lane]) return;
+    const int fID = MatchFunction(lane, tag, threshold);
+    if (fID < 0) return;
+    StartCore(lane, (size_t)fID, input);
+  }
+
+  /// Spawn a new core for an environment signal using the lane's tag bindings (input memory is empty).
+  void SpawnBoundCore(size_t lane, size_t tag_id) {
+    if (!inactive_cnt[lane]) return;
+    const TagBindings & bindings = *lane_bindings[lane];
+    const size_t match_cnt = bindings.GetMatchCnt(tag_id);
+    if (!match_cnt) return;
+    const uint32_t * matches = bindings.GetMatches(tag_id);
+    if (match_cnt == 1 || !stochastic_fun_call) StartCore(lane, matches[0], nullptr);
+    else StartCore(lane, matches[lane_random[lane]->GetUInt(0, match_cnt)], nullptr);
+  }
+
+  /// Claim an inactive core and start it on the given function.
+  void StartCore(size_t lane, size_t fID, const mem_t * input) {
+    lane_funcs_used[lane].Mark((size_t)fID);
+    const uint32_t core_id = inactive[lane * max_cores + (--inactive_cnt[lane])];
+    Core & core = GetCore(lane, core_id);
+    core.depth = 0;
+    core.block_cnt = 0;
+    core.stall = 0;
+    Frame & frame = core.Push();
+    frame.fp = (uint32_t)fID;
+    frame.ip = 0;
+    frame.block_base = 0;
+    frame.out_mask = 0;
+    frame.local.fill(0.0);
+    if (input) frame.input = *input;
+    else frame.input.fill(0.0);
+    frame.output.fill(0.0);
+    if (is_executing) pending[lane * max_cores + (pending_cnt[lane]++)] = core_id;
+    else active[lane * max_cores + (active_cnt[lane]++)] = core_id;
+  }
+
+  void CallFunction(size_t lane, Core & core, tag_t tag, double threshold) {
+    const int fID = MatchFunction(lane, tag, threshold);
+    if (fID < 0) return;
+    if (core.depth >= max_call_depth) return;
+    lane_funcs_used[lane].Mark((size_t)fID);
+    const size_t caller_id = core.depth - 1;
+    Frame & frame = core.Push();
+    frame.fp = (uint32_t)fID;
+    frame.ip = 0;
+    frame.block_base = (uint32_t)core.block_cnt;
+    frame.out_mask = 0;
+    frame.local.fill(0.0);
+    frame.input = core.frames[caller_id].local;
+    frame.output.fill(0.0);
+  }
+
+  void ReturnFunction(Core & core) {
+    Frame & returning = core.Top();
+    if (core.depth > 1) {
+      Frame & caller = core.frames[core.depth - 2];
+      for (uint32_t mask = returning.out_mask; mask; mask &= mask - 1) {
+        const size_t key = (size_t)__builtin_ctz(mask);
+        caller.local[key] = returning.output[key];
+      }
+    }
+    core.block_cnt = returning.block_base;
+    --core.depth;
+  }
+
+  void CloseBlock(Core & core) {
+    Frame & frame = core.Top();
+    if (core.block_cnt <= frame.block_base) return;
+    const Block & block = core.blocks[core.block_cnt - 1];
+    if (block.is_loop) frame.ip = block.begin;
+    --core.block_cnt;
+  }
+
+  void BreakBlock(Core & core, const Function & fun) {
+    Frame & frame = core.Top();
+    if (core.block_cnt <= frame.block_base) return;
+    const Block & block = core.blocks[core.block_cnt - 1];
+    frame.ip = block.end;
+    if (frame.ip < fun.len) ++frame.ip;
+    --core.block_cnt;
+  }
+
+  /// Skip over a block whose test failed.
+  static void SkipBlock(Frame & frame, const Inst & inst, const Function & fun) {
+    frame.ip = inst.imm;
+    if (frame.ip < fun.len) ++frame.ip;
+  }
+
+  /// Execute a single instruction on the given lane's core. Instruction pointer has already been advanced.
+  void Execute(size_t lane, Core & core, const Function & fun, const Inst & inst) {
+    Frame & frame = core.Top();
+    mem_t & local = frame.local;
+    const auto & args = inst.args;
+    switch (inst.op) {
+      case OP_INC: local[args[0]] += 1; break;
+      case OP_DEC: local[args[0]] -= 1; break;
+      case OP_NOT: local[args[0]] = (local[args[0]] == 0.0); break;
+      case OP_ADD: local[args[2]] = local[args[0]] + local[args[1]]; break;
+      case OP_SUB: local[args[2]] = local[args[0]] - local[args[1]]; break;
+      case OP_MULT: local[args[2]] = local[args[0]] * local[args[1]]; break;
+      case OP_DIV: {
+        const double denom = local[args[1]];
+        if (denom != 0.0) local[args[2]] = local[args[0]] / denom;
+        break;
+      }
+      case OP_MOD: {
+        const int base = (int)local[args[1]];
+        const int num = (int)local[args[0]];
+        if (base != 0) local[args[2]] = static_cast<int64_t>(num) % static_cast<int64_t>(base);
+        break;
+      }
+      case OP_TEST_EQU: local[args[2]] = (local[args[0]] == local[args[1]]); break;
+      case OP_TEST_NEQU: local[args[2]] = (local[args[0]] != local[args[1]]); break;
+      case OP_TEST_LESS: local[args[2]] = (local[args[0]] < local[args[1]]); break;
+      case OP_IF: {
+        if (local[args[0]] == 0.0) SkipBlock(frame, inst, fun);
+        else core.PushBlock(frame.ip, inst.imm, false);
+        break;
+      }
+      case OP_WHILE: {
+        if (local[args[0]] == 0.0) SkipBlock(frame, inst, fun);
+        else core.PushBlock(frame.ip - 1, inst.imm, true);
+        break;
+      }
+      case OP_COUNTDOWN: {
+        if (local[args[0]] == 0.0) SkipBlock(frame, inst, fun);
+        else { local[args[0]] -= 1; core.PushBlock(frame.ip - 1, inst.imm, true); }
+        break;
+      }
+      case OP_CLOSE: CloseBlock(core); break;
+      case OP_BREAK: BreakBlock(core, fun); break;
+      case OP_CALL: CallFunction(lane, core, inst.tag, lane_min_bind[lane]); break;
+      case OP_RETURN: ReturnFunction(core); break;
+      case OP_SET_MEM: local[args[0]] = (double)args[1]; break;
+      case OP_COPY_MEM: local[args[0]] = local[args[1]]; break;
+      case OP_SWAP_MEM: std::swap(local[args[0]], local[args[1]]); break;
+      case OP_INPUT: local[args[1]] = frame.input[args[0]]; break;
+      case OP_OUTPUT: {
+        frame.output[args[1]] = local[args[0]];
+        frame.out_mask |= ((uint32_t)1 << args[1]);
+        break;
+      }
+      case OP_COMMIT: lane_shared[lane * MEM_SIZE + args[1]] = local[args[0]]; break;
+      case OP_PULL: local[args[1]] = lane_shared[lane * MEM_SIZE + args[0]]; break;
+      case OP_NOP: break;
+      case OP_FORK: SpawnCore(lane, inst.tag, lane_min_bind[lane], &local); break;
+      case OP_TERMINATE: core.depth = 0; core.block_cnt = 0; break;
+      case OP_LOAD_1: {
+        size_t & load_id = lane_load_id[lane];
+        local[args[0]] = task_inputs[load_id];
+        load_id += 1;
+        if (load_id >= task_inputs.size()) load_id = 0;
+        break;
+      }
+      case OP_LOAD_2: {
+        local[args[0]] = task_inputs[0];
+        local[args[1]] = task_inputs[1];
+        break;
+      }
+      case OP_SUBMIT: {
+        const bool credit = IsInState(lane, env_state);
+        lane_tasks[lane]->Submit((task_io_t)local[args[0]], trial_time, credit);
+        break;
+      }
+      case OP_NAND: {
+        const task_io_t a = (task_io_t)local[args[0]];
+        const task_io_t b = (task_io_t)local[args[1]];
+        local[args[2]] = ~(a&b);
+        break;
+      }
+      case OP_SET_STATE: lane_state[lane] = (int64_t)inst.imm; break;
+      case OP_SENSE_STATE: local[args[0]] = (env_state == inst.imm); break;
+      case OP_FUSED: {
+        const size_t run = args[0];
+        RunLocal(lane, core, fun, lane_prog[lane]->fused_heads[inst.imm], &inst + 1, run - 1);
+        frame.ip += (uint32_t)(run - 1);
+        core.stall = run - 1;
+        break;
+      }
+      default: break;
+    }
+  }
+
+  /// Execute head followed by rest[0, rest_cnt), all local instructions (see IsLocalOp), back to back.
+  void RunLocal(size_t lane, Core & core, const Function & fun, const Inst & head, const Inst * rest, size_t rest_cnt) {
+#if defined(__GNUC__)
+    // Direct-threaded: each handler jumps straight to the next instruction's handler.
+    // Labels as values are a GNU extension; keep -pedantic (make debug) quiet about them.
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wpedantic"
+    static void * const dispatch[OP_CNT] = {
+      &&op_inc, &&op_dec, &&op_not, &&op_add, &&op_sub, &&op_mult, &&op_div, &&op_mod,
+      &&op_test_equ, &&op_test_nequ, &&op_test_less,
+      &&op_other, &&op_other, &&op_other, &&op_other, &&op_other,           // If, While, Countdown, Close, Break
+      &&op_other, &&op_other,                                               // Call, Return
+      &&op_set_mem, &&op_copy_mem, &&op_swap_mem, &&op_input, &&op_output,
+      &&op_other, &&op_other,                                               // Commit, Pull
+      &&op_next, &&op_other, &&op_other,                                    // Nop, Fork, Terminate
+      &&op_other, &&op_load_2, &&op_other, &&op_nand,                       // Load-1, Load-2, Submit, Nand
+      &&op_other, &&op_other, &&op_other                                    // SetState, SenseState, Fused
+    };
+    Frame & frame = core.Top();
+    mem_t & local = frame.local;
+    const Inst * inst = &head;
+    size_t next = 0;
+    #define LOCKSTEP_NEXT() if (next == rest_cnt) return; inst = rest + (next++); goto *dispatch[inst->op]
+    goto *dispatch[inst->op];
+    op_inc: local[inst->args[0]] += 1; LOCKSTEP_NEXT();
+    op_dec: local[inst->args[0]] -= 1; LOCKSTEP_NEXT();
+    op_not: local[inst->args[0]] = (local[inst->args[0]] == 0.0); LOCKSTEP_NEXT();
+    op_add: local[inst->args[2]] = local[inst->args[0]] + local[inst->args[1]]; LOCKSTEP_NEXT();
+    op_sub: local[inst->args[2]] = local[inst->args[0]] - local[inst->args[1]]; LOCKSTEP_NEXT();
+    op_mult: local[inst->args[2]] = local[inst->args[0]] * local[inst->args[1]]; LOCKSTEP_NEXT();
+    op_div: {
+      const double denom = local[inst->args[1]];
+      if (denom != 0.0) local[inst->args[2]] = local[inst->args[0]] / denom;
+      LOCKSTEP_NEXT();
+    }
+    op_mod: {
+      const int base = (int)local[inst->args[1]];
+      const int num = (int)local[inst->args[0]];
+      if (base != 0) local[inst->args[2]] = static_cast<int64_t>(num) % static_cast<int64_t>(base);
+      LOCKSTEP_NEXT();
+    }
+    op_test_equ: local[inst->args[2]] = (local[inst->args[0]] == local[inst->args[1]]); LOCKSTEP_NEXT();
+    op_test_nequ: local[inst->args[2]] = (local[inst->args[0]] != local[inst->args[1]]); LOCKSTEP_NEXT();
+    op_test_less: local[inst->args[2]] = (local[inst->args[0]] < local[inst->args[1]]); LOCKSTEP_NEXT();
+    op_set_mem: local[inst->args[0]] = (double)inst->args[1]; LOCKSTEP_NEXT();
+    op_copy_mem: local[inst->args[0]] = local[inst->args[1]]; LOCKSTEP_NEXT();
+    op_swap_mem: std::swap(local[inst->args[0]], local[inst->args[1]]); LOCKSTEP_NEXT();
+    op_input: local[inst->args[1]] = frame.input[inst->args[0]]; LOCKSTEP_NEXT();
+    op_output: {
+      frame.output[inst->args[1]] = local[inst->args[0]];
+      frame.out_mask |= ((uint32_t)1 << inst->args[1]);
+      LOCKSTEP_NEXT();
+    }
+    op_load_2: {
+      local[inst->args[0]] = task_inputs[0];
+      local[inst->args[1]] = task_inputs[1];
+      LOCKSTEP_NEXT();
+    }
+    op_nand: {
+      const task_io_t a = (task_io_t)local[inst->args[0]];
+      const task_io_t b = (task_io_t)local[inst->args[1]];
+      local[inst->args[2]] = ~(a&b);
+      LOCKSTEP_NEXT();
+    }
+    op_other: Execute(lane, core, fun, *inst); // Never fused; handled normally.
+    op_next: LOCKSTEP_NEXT();
+    #undef LOCKSTEP_NEXT
+    #pragma GCC diagnostic pop
+#else
+    Execute(lane, core, fun, head);
+    for (size_t i = 0; i < rest_cnt; ++i) Execute(lane, core, fun, rest[i]);
+#endif
+  }
+
+  /// Advance a single lane by one timestep (equivalent to EventDrivenGP::SingleProcess).
+  void StepLane(size_t lane) {
+    const Program & prog = *lane_prog[lane];
+    // Handle environment signals.
+    for (size_t i = 0; i < signal_cnt; ++i) SpawnBoundCore(lane, signal_queue[i]);
+    // Give every active core one instruction's worth of time.
+    uint32_t * lane_active = &active[lane * max_cores];
+    const size_t core_cnt = active_cnt[lane];
+    size_t adjust = 0;
+    is_executing = true;
+    for (size_t idx = 0; idx < core_cnt; ++idx) {
+      const uint32_t core_id = lane_active[idx];
+      if (adjust) lane_active[idx - adjust] = core_id;
+      Core & core = GetCore(lane, core_id);
+      if (core.stall) {
+        --core.stall;  // Still 'executing' a fused run.
+      } else {
+        Frame & frame = core.Top();
+        const Function & fun = prog.functions[frame.fp];
+        if (frame.ip < fun.len) {
+          const Inst & inst = prog.code[fun.begin + frame.ip];
+          ++frame.ip;
+          Execute(lane, core, fun, inst);
+        } else if (core.block_cnt > frame.block_base) {
+          CloseBlock(core);
+        } else {
+          ReturnFunction(core);
+        }
+      }
+      if (!core.depth) {
+        inactive[lane * max_cores + (inactive_cnt[lane]++)] = core_id;
+        ++adjust;
+      }
+    }
+    active_cnt[lane] = core_cnt - adjust;
+    // Activate cores spawned during execution.
+    for (size_t i = 0; i < pending_cnt[lane]; ++i) {
+      lane_active[active_cnt[lane]++] = pending[lane * max_cores + i];
+    }
+    pending_cnt[lane] = 0;
+    is_executing = false;
+  }
+
+public:
+  LockstepHardware(size_t _lanes=1, size_t _max_cores=16, size_t _max_call_depth=128)
+    : lane_cnt(0), max_cores(_max_cores), max_call_depth(_max_call_depth),
+      stochastic_fun_call(true), env_state((size_t)-1), trial_time(0),
+      task_inputs(), signal_queue(), signal_cnt(0), dropped_signal_cnt(0), frame_depth(0), is_executing(false),
+      reset_image()
+  {
+    for (size_t i = 0; i < task_inputs.size(); ++i) task_inputs[i] = 0;
+    match_buffer.reserve(MAX_FUNCS);
+    SetLaneCnt(_lanes);
+  }
+  LockstepHardware(const LockstepHardware &) = delete;   // Cores point into the frame pool.
+  LockstepHardware & operator=(const LockstepHardware &) = delete;
+
+  size_t GetLaneCnt() const { return lane_cnt; }
+  size_t GetMaxCores() const { return max_cores; }
+  size_t GetMaxCallDepth() const { return max_call_depth; }
+  size_t GetDroppedSignalCnt() const { return dropped_signal_cnt; }
+
+  /// Bytes set aside for call states (frame pool).
+  size_t GetFramePoolBytes() const { return frame_pool.size() * sizeof(Frame); }
+
+  /// Resize the batch. Clears all lanes.
+  void SetLaneCnt(size_t lanes) {
+    lane_cnt = lanes;
+    lane_prog.assign(lanes, nullptr);
+    lane_min_bind.assign(lanes, 0.0);
+    lane_state.assign(lanes, -1);
+    lane_load_id.assign(lanes, 0);
+    lane_random.assign(lanes, nullptr);
+    lane_tasks.assign(lanes, nullptr);
+    lane_bindings.assign(lanes, nullptr);
+    lane_funcs_used.resize(lanes);
+    lane_shared.assign(lanes * MEM_SIZE, 0.0);
+    cores.clear();
+    cores.resize(lanes * max_cores);
+    frame_depth = (max_call_depth) ? max_call_depth : 1;
+    frame_pool.clear();
+    frame_pool.resize(lanes * max_cores * frame_depth);
+    for (size_t i = 0; i < cores.size(); ++i) {
+      cores[i].frames = frame_pool.data() + i * frame_depth;
+      cores[i].blocks.reserve(frame_depth);  // Typical case; deeper block nesting grows it (see Core::PushBlock).
+    }
+    active.assign(lanes * max_cores, 0);
+    active_cnt.assign(lanes, 0);
+    inactive.assign(lanes * max_cores, 0);
+    inactive_cnt.assign(lanes, 0);
+    pending.assign(lanes * max_cores, 0);
+    pending_cnt.assign(lanes, 0);
+    // Every trial starts with every core inactive, handed out from core 0 up.
+    reset_image = LaneImage();
+    for (size_t i = 0; i < max_cores; ++i) reset_image.inactive.emplace_back((uint32_t)(max_cores - 1 - i));
+    for (size_t lane = 0; lane < lanes; ++lane) ResetLane(lane);
+  }
+
+  void SetMaxCores(size_t val) { max_cores = val; SetLaneCnt(lane_cnt); }
+  void SetMaxCallDepth(size_t val) { max_call_depth = val; SetLaneCnt(lane_cnt); }
+  void SetStochasticFunCall(bool val) { stochastic_fun_call = val; }
+
+  /// Configure a lane to run the given (already decoded) program. Program and bindings must outlive their use.
+  void SetLane(size_t lane, emp::Ptr<const Program> prog, emp::Ptr<const TagBindings> bindings,
+               double min_bind_thresh, emp::Ptr<emp::Random> rnd, emp::Ptr<taskset_t> tasks) {
+    lane_prog[lane] = prog;
+    lane_bindings[lane] = bindings;
+    lane_min_bind[lane] = min_bind_thresh;
+    lane_random[lane] = rnd;
+    lane_tasks[lane] = tasks;
+  }
+
+  /// Reset a lane's hardware (cores, shared memory, internal state) for a new trial.
+  ///  - Every trial starts from the blank reset image, so this is a handful of bulk copies. Core storage (call
+  ///    states and block stacks) is kept.
+  void ResetLane(size_t lane) {
+    emp_assert(!is_executing);
+    for (size_t i = 0; i < max_cores; ++i) {
+      Core & core = GetCore(lane, i);
+      core.depth = 0;
+      core.block_cnt = 0;
+      core.stall = 0;
+    }
+    const size_t base = lane * max_cores;
+    std::copy(reset_image.inactive.begin(), reset_image.inactive.end(), inactive.begin() + base);
+    inactive_cnt[lane] = reset_image.inactive.size();
+    active_cnt[lane] = 0;
+    pending_cnt[lane] = 0;
+    std::copy(reset_image.shared.begin(), reset_image.shared.end(), lane_shared.begin() + lane * MEM_SIZE);
+    lane_state[lane] = reset_image.state;
+    lane_load_id[lane] = reset_image.load_id;
+    lane_funcs_used[lane] = reset_image.funcs_used;
+  }
+
+  /// Set the environment every lane sees during the next step.
+  void SetEnvironment(size_t _env_state, size_t _trial_time) { env_state = _env_state; trial_time = _trial_time; }
+  void SetTaskInputs(const task_inputs_t & inputs) { task_inputs = inputs; }
+
+  /// Send an environment signal (tag ID in every lane's bindings) to every lane.
+  /// Handled at the beginning of the next step. Dropped (and counted, see GetDroppedSignalCnt) if
+  /// MAX_QUEUED_SIGNALS signals are already queued.
+  void QueueSignal(size_t tag_id) {
+    emp_assert(signal_cnt < MAX_QUEUED_SIGNALS, "Signal queue overflow.", MAX_QUEUED_SIGNALS);
+    if (signal_cnt < MAX_QUEUED_SIGNALS) signal_queue[signal_cnt++] = (uint32_t)tag_id;
+    else ++dropped_signal_cnt;
+  }
+
+  /// Does the given lane's internal state match the given environment state?
+  bool IsInState(size_t lane, size_t state) const {
+    return lane_state[lane] >= 0 && (size_t)lane_state[lane] == state;
+  }
+
+  int64_t GetState(size_t lane) const { return lane_state[lane]; }
+  size_t GetFunctionsUsed(size_t lane) const { return lane_funcs_used[lane].GetUsedCnt(); }
+  const func_usage_t & GetFunctionUsage(size_t lane) const { return lane_funcs_used[lane]; }
+  size_t GetActiveCoreCnt(size_t lane) const { return active_cnt[lane]; }
+
+  /// Are the first lanes lanes idle (no active cores and no queued signals)?
+  bool IsIdle(size_t lanes) const {
+    if (signal_cnt) return false;
+    for (size_t lane = 0; lane < lanes; ++lane) {
+      if (active_cnt[lane]) return false;
+    }
+    return true;
+  }
+
+  /// Advance the first lanes lanes by a single timestep.
+  void Step(size_t lanes) {
+    for (size_t lane = 0; lane < lanes; ++lane) StepLane(lane);
+    signal_cnt = 0;
+  }
+
+  /// Advance every lane by a single timestep.
+  void Step() { Step(lane_cnt); }
+};
+
+#endif
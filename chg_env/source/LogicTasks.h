@@ -0,0 +1,63 @@
+#ifndef CHG_ENV_LOGIC_TASKS_H
+#define CHG_ENV_LOGIC_TASKS_H
+
+#include <array>
+#include <cstddef>
+
+/// Compile-time table of the logic-9 (+ ECHO) tasks.
+///  - Every task's solutions occupy a fixed range of slots in one solution array, in task order.
+///  - LogicTaskSolutions computes every solution for an input pair in a single branch-free pass.
+
+constexpr size_t LOGIC_TASK_CNT = 10;
+constexpr size_t LOGIC_TASK_SOLUTION_CNT = 14;
+
+struct LogicTaskInfo {
+  const char * name;
+  const char * desc;
+  size_t sol_begin;   ///< First solution slot that belongs to this task.
+  size_t sol_cnt;     ///< Number of solution slots that belong to this task.
+};
+
+constexpr std::array<LogicTaskInfo, LOGIC_TASK_CNT> LOGIC_TASKS = {{
+  {"NAND", "NAND task", 0, 1},
+  {"NOT", "NOT task", 1, 2},
+  {"ORN", "ORN task", 3, 2},
+  {"AND", "AND task", 5, 1},
+  {"OR", "OR task", 6, 1},
+  {"ANDN", "ANDN task", 7, 2},
+  {"NOR", "NOR task", 9, 1},
+  {"XOR", "XOR task", 10, 1},
+  {"EQU", "EQU task", 11, 1},
+  {"ECHO", "ECHO task", 12, 2}
+}};
+
+/// Every logic task solution for inputs a and b (slots laid out as in LOGIC_TASKS).
+template<typename T>
+constexpr std::array<T, LOGIC_TASK_SOLUTION_CNT> LogicTaskSolutions(T a, T b) {
+  return {{
+    (T)~(a&b),              // NAND
+    (T)~a, (T)~b,           // NOT
+    (T)(a|~b), (T)(b|~a),   // ORN
+    (T)(a&b),               // AND
+    (T)(a|b),               // OR
+    (T)(a&~b), (T)(b&~a),   // ANDN
+    (T)~(a|b),              // NOR
+    (T)(a^b),               // XOR
+    (T)~(a^b),              // EQU
+    a, b                    // ECHO
+  }};
+}
+
+/// Do any two logic task solutions collide?
+template<typename T>
+bool HasLogicTaskCollision(const std::array<T, LOGIC_TASK_SOLUTION_CNT> & sols) {
+  bool collision = false;
+  for (size_t i = 0; i < LOGIC_TASK_SOLUTION_CNT; ++i) {
+    for (size_t j = i + 1; j < LOGIC_TASK_SOLUTION_CNT; ++j) {
+      collision |= (sols[i] == sols[j]);
+    }
+  }
+  return collision;
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef CHG_ENV_MAP_ARCHIVE_H
+#define CHG_ENV_MAP_ARCHIVE_H
+
+#include <unordered_map>
+#include <cstdint>
+
+#include "base/assert.h"
+#include "base/vector.h"
+
+/// Sparse index of a MAP-Elites archive: maps occupied grid cells to compact slots [0, GetSize()).
+///  - Cells are keyed by their 64-bit grid index, so the grid itself can be far larger than the archive.
+///  - Slots are handed out in order of first occupation and never given back (MAP-Elites cells stay occupied).
+class MapArchive {
+public:
+  static constexpr size_t NO_SLOT = (size_t)-1;
+
+protected:
+  std::unordered_map<uint64_t, size_t> slots;   ///< Cell => slot.
+  emp::vector<uint64_t> cells;                  ///< Slot => cell.
+
+public:
+  MapArchive() : slots(), cells() { ; }
+
+  size_t GetSize() const { return cells.size(); }
+  uint64_t GetCell(size_t slot) const { emp_assert(slot < cells.size()); return cells[slot]; }
+
+  /// Slot of the given cell, or NO_SLOT if the cell is empty.
+  size_t Find(uint64_t cell) const {
+    auto it = slots.find(cell);
+    return (it == slots.end()) ? NO_SLOT : it->second;
+  }
+
+  /// Slot of the given cell, opening a new slot if the cell is empty.
+  size_t Insert(uint64_t cell) {
+    auto result = slots.emplace(cell, cells.size());
+    if (result.second) cells.emplace_back(cell);
+    return result.first->second;
+  }
+
+  void Clear() { slots.clear(); cells.clear(); }
+};
+
+#endif
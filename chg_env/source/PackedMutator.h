@@ -0,0 +1,280 @@
+#ifndef CHG_ENV_PACKED_MUTATOR_H
+#define CHG_ENV_PACKED_MUTATOR_H
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <functional>
+
+#include "base/assert.h"
+#include "base/vector.h"
+#include "tools/Random.h"
+
+#include "PackedProgram.h"
+
+/// SignalGP program mutator that works directly on packed programs (see PackedProgram) and jumps straight to
+/// mutation sites instead of rolling a die for every site.
+///  - Same operators, rates, limits, and order of operations as toolbelt::SignalGPMutator: function duplications,
+///    function deletions, then, for every function, tag bit flips, a slip mutation, instruction (tag bit, ID, and
+///    argument) substitutions, and instruction insertions/deletions.
+///  - Every per-site process (per tag bit, per instruction, per argument, per function) is sampled by drawing the
+///    gap to the next mutated site from a geometric distribution; insertion counts are binomial draws made the same
+///    way. The distribution of mutations is unchanged, and the work done scales with the number of mutations
+///    rather than with program size. Random numbers get consumed differently than by the per-site mutator, though.
+///  - Not thread-safe (reuses internal buffers).
+template<size_t TAG_WIDTH>
+class PackedMutator {
+public:
+  static_assert(TAG_WIDTH <= 32, "Packed programs store tags as 32-bit words.");
+
+protected:
+  /// Bernoulli process sampled by its gaps.
+  struct SiteSampler {
+    double log_q;   ///< log(1 - p)
+    double p;
+
+    SiteSampler(double _p=0) : log_q(0), p(0) { SetP(_p); }
+
+    void SetP(double _p) { p = _p; log_q = (p > 0.0 && p < 1.0) ? std::log1p(-p) : 0.0; }
+
+    /// Number of sites to skip before the next mutated site.
+    size_t Gap(emp::Random & rnd) const {
+      if (p <= 0.0) return std::numeric_limits<size_t>::max();
+      if (p >= 1.0) return 0;
+      const double gap = std::floor(std::log(1.0 - rnd.GetDouble()) / log_q);
+      return (gap < (double)std::numeric_limits<uint32_t>::max()) ? (size_t)gap : std::numeric_limits<size_t>::max();
+    }
+
+    /// Call fun(site) for every mutated site in [0, site_cnt), in order.
+    template<typename FUN_T>
+    void ForEachSite(emp::Random & rnd, size_t site_cnt, FUN_T fun) const {
+      size_t site = Gap(rnd);
+      while (site < site_cnt) {
+        fun(site);
+        const size_t gap = Gap(rnd);
+        if (gap >= site_cnt - site - 1) break;
+        site += gap + 1;
+      }
+    }
+
+    /// Number of mutated sites in [0, site_cnt) (a binomial draw).
+    size_t Count(emp::Random & rnd, size_t site_cnt) const {
+      size_t cnt = 0;
+      ForEachSite(rnd, site_cnt, [&cnt](size_t) { ++cnt; });
+      return cnt;
+    }
+  };
+
+  struct Function {
+    uint32_t tag;
+    emp::vector<uint64_t> insts;
+  };
+
+  size_t prog_min_func_cnt;
+  size_t prog_max_func_cnt;
+  size_t prog_min_func_len;
+  size_t prog_max_func_len;
+  size_t prog_max_total_len;
+  int prog_max_arg_val;
+  size_t inst_cnt;    ///< Instruction set size (substituted/inserted instruction IDs are drawn from [0, inst_cnt)).
+
+  SiteSampler tag_bflip;
+  SiteSampler inst_sub;
+  SiteSampler inst_ins;
+  SiteSampler inst_del;
+  SiteSampler func_slip;
+  SiteSampler func_dup;
+  SiteSampler func_del;
+
+  emp::vector<Function> funcs;      ///< Program being mutated (first func_cnt functions; the rest keep their storage).
+  size_t func_cnt;
+  Function scratch;                 ///< Used to rebuild a function.
+  emp::vector<size_t> ins_locs;
+
+  static constexpr uint32_t TAG_MASK = (TAG_WIDTH == 32) ? 0xFFFFFFFF : (uint32_t)(((uint64_t)1 << TAG_WIDTH) - 1);
+
+  uint64_t RandomInst(emp::Random & rnd) const {
+    const size_t id = rnd.GetUInt(inst_cnt);
+    const int a0 = rnd.GetInt(prog_max_arg_val);
+    const int a1 = rnd.GetInt(prog_max_arg_val);
+    const int a2 = rnd.GetInt(prog_max_arg_val);
+    return PackedProgram::PackInst(id, a0, a1, a2, rnd.GetUInt() & TAG_MASK);
+  }
+
+  static uint64_t SetInstID(uint64_t word, size_t id) { return (word & ~(uint64_t)0xFF) | (uint64_t)id; }
+  static uint64_t SetArg(uint64_t word, size_t arg, int val) {
+    const size_t shift = 8 + 8 * arg;
+    return (word & ~((uint64_t)0xFF << shift)) | ((uint64_t)val << shift);
+  }
+
+  /// Slip mutation: duplicate or delete a random stretch of the function (if that doesn't break length limits).
+  bool Slip(emp::Random & rnd, Function & fun, size_t & total_len) {
+    const size_t len = fun.insts.size();
+    if (!len) return false;
+    const size_t begin = rnd.GetUInt(len);
+    const size_t end = rnd.GetUInt(len);
+    if (begin < end) {
+      const size_t dup_size = end - begin;
+      if (total_len + dup_size > prog_max_total_len || len + dup_size > prog_max_func_len) return false;
+      // Insert a copy of [begin, end) at end.
+      scratch.insts.assign(fun.insts.begin() + begin, fun.insts.begin() + end);
+      fun.insts.insert(fun.insts.begin() + end, scratch.insts.begin(), scratch.insts.end());
+      total_len += dup_size;
+      return true;
+    } else if (begin > end) {
+      const size_t del_size = begin - end;
+      if (len - del_size < prog_min_func_len) return false;
+      // Delete [end, begin).
+      fun.insts.erase(fun.insts.begin() + end, fun.insts.begin() + begin);
+      total_len -= del_size;
+      return true;
+    }
+    return false;
+  }
+
+  /// Instruction insertions and deletions. Returns the number of mutations.
+  size_t InsertDelete(emp::Random & rnd, Function & fun, size_t & total_len) {
+    const size_t len = fun.insts.size();
+    size_t ins_cnt = inst_ins.Count(rnd, len);
+    if (ins_cnt + len > prog_max_func_len) ins_cnt = (prog_max_func_len > len) ? prog_max_func_len - len : 0;
+    if (ins_cnt + total_len > prog_max_total_len) ins_cnt = (prog_max_total_len > total_len) ? prog_max_total_len - total_len : 0;
+    size_t next_del = inst_del.Gap(rnd);
+    if (!ins_cnt && next_del >= len) return 0;
+    total_len += ins_cnt;
+    // Insertion locations, visited from the back of the list.
+    ins_locs.resize(ins_cnt);
+    for (size_t i = 0; i < ins_cnt; ++i) ins_locs[i] = rnd.GetUInt(len);
+    std::sort(ins_locs.begin(), ins_locs.end(), std::greater<size_t>());
+    size_t mut_cnt = 0;
+    size_t cur_len = len + ins_cnt;
+    scratch.insts.clear();
+    for (size_t rhead = 0; rhead < len; ++rhead) {
+      // Insert random instructions before this one.
+      while (ins_locs.size() && ins_locs.back() <= rhead) {
+        scratch.insts.emplace_back(RandomInst(rnd));
+        ins_locs.pop_back();
+        ++mut_cnt;
+      }
+      // Delete this instruction?
+      if (rhead == next_del) {
+        const size_t gap = inst_del.Gap(rnd);
+        next_del = (gap < len - rhead - 1) ? rhead + gap + 1 : len;
+        if (cur_len > prog_min_func_len) {
+          --cur_len;
+          --total_len;
+          ++mut_cnt;
+          continue;
+        }
+      }
+      scratch.insts.emplace_back(fun.insts[rhead]);
+    }
+    std::swap(fun.insts, scratch.insts);
+    return mut_cnt;
+  }
+
+public:
+  PackedMutator()
+    : prog_min_func_cnt(1), prog_max_func_cnt(8), prog_min_func_len(1), prog_max_func_len(8),
+      prog_max_total_len(256), prog_max_arg_val(16), inst_cnt(1),
+      tag_bflip(), inst_sub(), inst_ins(), inst_del(), func_slip(), func_dup(), func_del(),
+      funcs(), func_cnt(0), scratch(), ins_locs() { ; }
+
+  void SetProgMinFuncCnt(size_t val) { prog_min_func_cnt = val; }
+  void SetProgMaxFuncCnt(size_t val) { prog_max_func_cnt = val; }
+  void SetProgMinFuncLen(size_t val) { prog_min_func_len = val; }
+  void SetProgMaxFuncLen(size_t val) { prog_max_func_len = val; }
+  void SetProgMaxTotalLen(size_t val) { prog_max_total_len = val; }
+  void SetProgMaxArgVal(int val) { prog_max_arg_val = val; }
+  void SetInstCnt(size_t val) { emp_assert(val > 0 && val <= PackedProgram::MAX_INST_ID + 1, val); inst_cnt = val; }
+  void SetPerBitTagBitFlipRate(double val) { tag_bflip.SetP(val); }
+  void SetPerInstSubRate(double val) { inst_sub.SetP(val); }
+  void SetPerInstInsRate(double val) { inst_ins.SetP(val); }
+  void SetPerInstDelRate(double val) { inst_del.SetP(val); }
+  void SetPerFuncSlipRate(double val) { func_slip.SetP(val); }
+  void SetPerFuncDupRate(double val) { func_dup.SetP(val); }
+  void SetPerFuncDelRate(double val) { func_del.SetP(val); }
+
+  /// Mutate a copy of prog, writing the mutated program's packed words into out (function count: out_func_cnt).
+  /// Returns the number of mutations (out is only filled in if there were any).
+  size_t ApplyMutations(const PackedProgram & prog, emp::Random & rnd, emp::vector<uint64_t> & out, size_t & out_func_cnt) {
+    // Load program.
+    func_cnt = 0;
+    prog.ForEachFunction([this](size_t fID, uint32_t tag, const uint64_t * insts, size_t len) {
+      if (func_cnt == funcs.size()) funcs.emplace_back();
+      funcs[func_cnt].tag = tag;
+      funcs[func_cnt].insts.assign(insts, insts + len);
+      ++func_cnt;
+    });
+    size_t total_len = prog.GetInstCnt();
+    size_t mut_cnt = 0;
+
+    // Duplicate functions?
+    func_dup.ForEachSite(rnd, func_cnt, [this, &total_len, &mut_cnt](size_t fID) {
+      if (func_cnt >= prog_max_func_cnt || total_len + funcs[fID].insts.size() > prog_max_total_len) return;
+      if (func_cnt == funcs.size()) funcs.emplace_back();
+      funcs[func_cnt].tag = funcs[fID].tag;
+      funcs[func_cnt].insts.assign(funcs[fID].insts.begin(), funcs[fID].insts.end());
+      total_len += funcs[fID].insts.size();
+      ++func_cnt;
+      ++mut_cnt;
+    });
+
+    // Delete functions? (A deleted function is replaced by the last one, which then gets its own roll.)
+    size_t gap = func_del.Gap(rnd);
+    for (size_t fID = 0; fID < func_cnt; ++fID) {
+      if (gap) { --gap; continue; }
+      gap = func_del.Gap(rnd);
+      if (func_cnt <= prog_min_func_cnt) continue;
+      total_len -= funcs[fID].insts.size();
+      std::swap(funcs[fID], funcs[func_cnt - 1]);
+      --func_cnt;
+      ++mut_cnt;
+      --fID;
+    }
+
+    size_t slip_gap = func_slip.Gap(rnd);
+    for (size_t fID = 0; fID < func_cnt; ++fID) {
+      Function & fun = funcs[fID];
+      // Function tag bit flips.
+      tag_bflip.ForEachSite(rnd, TAG_WIDTH, [&fun, &mut_cnt](size_t bit) {
+        fun.tag ^= ((uint32_t)1 << bit);
+        ++mut_cnt;
+      });
+      // Slip mutation?
+      if (slip_gap) {
+        --slip_gap;
+      } else {
+        slip_gap = func_slip.Gap(rnd);
+        if (Slip(rnd, fun, total_len)) ++mut_cnt;
+      }
+      // Instruction tag bit flips.
+      tag_bflip.ForEachSite(rnd, fun.insts.size() * TAG_WIDTH, [&fun, &mut_cnt](size_t site) {
+        fun.insts[site / TAG_WIDTH] ^= ((uint64_t)1 << (32 + (site % TAG_WIDTH)));
+        ++mut_cnt;
+      });
+      // Instruction ID and argument substitutions (arguments mutate even if the instruction doesn't use them).
+      inst_sub.ForEachSite(rnd, fun.insts.size() * 4, [this, &rnd, &fun, &mut_cnt](size_t site) {
+        uint64_t & inst = fun.insts[site / 4];
+        const size_t which = site % 4;
+        if (which == 0) inst = SetInstID(inst, rnd.GetUInt(inst_cnt));
+        else inst = SetArg(inst, which - 1, rnd.GetInt(prog_max_arg_val));
+        ++mut_cnt;
+      });
+      // Instruction insertions/deletions.
+      mut_cnt += InsertDelete(rnd, fun, total_len);
+    }
+
+    out_func_cnt = func_cnt;
+    if (!mut_cnt) return 0;
+    out.clear();
+    for (size_t fID = 0; fID < func_cnt; ++fID) {
+      const Function & fun = funcs[fID];
+      out.emplace_back(PackedProgram::PackFunctionHeader(fun.insts.size(), fun.tag));
+      out.insert(out.end(), fun.insts.begin(), fun.insts.end());
+    }
+    return mut_cnt;
+  }
+};
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef CHG_ENV_PACKED_PROGRAM_H
+#define CHG_ENV_PACKED_PROGRAM_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "base/assert.h"
+#include "base/Ptr.h"
+#include "base/vector.h"
+
+/// Storage for packed programs.
+///  - Memory comes from large chunks, carved into blocks whose sizes are multiples of BLOCK_WORDS words.
+///  - Freed blocks go on a per-size free list and get handed out again to programs of the same size class, so a
+///    population's programs keep living in the same few chunks from one generation to the next.
+///  - Chunks are only released when the arena is destroyed.
+///  - Not thread-safe: create and destroy programs serially (evaluation threads only read them).
+class PackedProgramArena {
+public:
+  static constexpr size_t BLOCK_WORDS = 8;
+  static constexpr size_t CHUNK_WORDS = 1 << 16;
+
+protected:
+  emp::vector<emp::vector<uint64_t>> chunks;
+  size_t cur_chunk;     ///< Chunk new blocks are carved from.
+  size_t chunk_used;    ///< Words already carved from the current chunk.
+  emp::vector<emp::vector<uint64_t *>> free_blocks;   ///< Size class => freed blocks of that size.
+  size_t live_words;    ///< Words in blocks currently in use.
+  size_t live_blocks;
+  size_t reserved_words;
+
+public:
+  PackedProgramArena()
+    : chunks(), cur_chunk(0), chunk_used(CHUNK_WORDS), free_blocks(),
+      live_words(0), live_blocks(0), reserved_words(0) { ; }
+  PackedProgramArena(const PackedProgramArena &) = delete;
+  PackedProgramArena & operator=(const PackedProgramArena &) = delete;
+
+  /// Size class of a block that can hold the given number of words.
+  static size_t GetSizeClass(size_t words) { return (words) ? (words + BLOCK_WORDS - 1) / BLOCK_WORDS : 1; }
+
+  size_t GetLiveBlocks() const { return live_blocks; }
+  size_t GetLiveBytes() const { return live_words * sizeof(uint64_t); }
+  size_t GetReservedBytes() const { return reserved_words * sizeof(uint64_t); }
+
+  uint64_t * Alloc(size_t size_class) {
+    emp_assert(size_class > 0);
+    const size_t words = size_class * BLOCK_WORDS;
+    live_words += words;
+    ++live_blocks;
+    if (size_class < free_blocks.size() && free_blocks[size_class].size()) {
+      uint64_t * block = free_blocks[size_class].back();
+      free_blocks[size_class].pop_back();
+      return block;
+    }
+    if (words > CHUNK_WORDS) {
+      // Oversized block: gets a chunk of its own.
+      chunks.emplace_back(words);
+      reserved_words += words;
+      return chunks.back().data();
+    }
+    if (chunk_used + words > CHUNK_WORDS) {
+      chunks.emplace_back((size_t)CHUNK_WORDS);
+      reserved_words += CHUNK_WORDS;
+      cur_chunk = chunks.size() - 1;
+      chunk_used = 0;
+    }
+    uint64_t * block = chunks[cur_chunk].data() + chunk_used;
+    chunk_used += words;
+    return block;
+  }
+
+  void Free(uint64_t * block, size_t size_class) {
+    emp_assert(live_blocks > 0);
+    if (size_class >= free_blocks.size()) free_blocks.resize(size_class + 1);
+    free_blocks[size_class].emplace_back(block);
+    live_words -= size_class * BLOCK_WORDS;
+    --live_blocks;
+  }
+};
+
+/// SignalGP program packed into one contiguous block of 64-bit words (allocated from a PackedProgramArena).
+///  - Every function is a header word (bits 0-31: instruction count, bits 32-63: tag) followed by its instructions.
+///  - Every instruction is one word (bits 0-7: instruction ID, bits 8-31: three 8-bit arguments, bits 32-63: tag),
+///    so instruction IDs and arguments must be in [0, 256) and tags at most 32 bits wide.
+///  - Immutable once built.
+class PackedProgram {
+public:
+  static constexpr size_t MAX_INST_ID = 255;
+  static constexpr int MAX_ARG = 255;
+
+  static uint64_t PackInst(size_t id, int a0, int a1, int a2, uint32_t tag) {
+    emp_assert(id <= MAX_INST_ID, id);
+    emp_assert(a0 >= 0 && a0 <= MAX_ARG && a1 >= 0 && a1 <= MAX_ARG && a2 >= 0 && a2 <= MAX_ARG, a0, a1, a2);
+    return (uint64_t)id | ((uint64_t)a0 << 8) | ((uint64_t)a1 << 16) | ((uint64_t)a2 << 24) | ((uint64_t)tag << 32);
+  }
+  static uint64_t PackFunctionHeader(size_t len, uint32_t tag) { return (uint64_t)len | ((uint64_t)tag << 32); }
+
+  static size_t GetInstID(uint64_t word) { return (size_t)(word & 0xFF); }
+  static int GetArg(uint64_t word, size_t arg) { return (int)((word >> (8 + 8 * arg)) & 0xFF); }
+  static uint32_t GetTag(uint64_t word) { return (uint32_t)(word >> 32); }
+  static size_t GetFunctionLen(uint64_t header) { return (size_t)(header & 0xFFFFFFFF); }
+
+protected:
+  emp::Ptr<PackedProgramArena> arena;
+  uint64_t * words;
+  uint32_t word_cnt;
+  uint32_t func_cnt;
+
+public:
+  /// Copy an already packed word sequence (function headers and instructions) into the arena.
+  PackedProgram(emp::Ptr<PackedProgramArena> _arena, const uint64_t * _words, size_t _word_cnt, size_t _func_cnt)
+    : arena(_arena), words(nullptr), word_cnt((uint32_t)_word_cnt), func_cnt((uint32_t)_func_cnt)
+  {
+    words = arena->Alloc(PackedProgramArena::GetSizeClass(word_cnt));
+    if (word_cnt) std::memcpy(words, _words, word_cnt * sizeof(uint64_t));
+  }
+  PackedProgram(const PackedProgram &) = delete;
+  PackedProgram & operator=(const PackedProgram &) = delete;
+  ~PackedProgram() { arena->Free(words, PackedProgramArena::GetSizeClass(word_cnt)); }
+
+  size_t GetSize() const { return func_cnt; }
+  size_t GetInstCnt() const { return word_cnt - func_cnt; }
+  size_t GetWordCnt() const { return word_cnt; }
+  const uint64_t * GetWords() const { return words; }
+
+  /// Bytes taken up by this program (including its unused block tail).
+  size_t GetByteSize() const {
+    return sizeof(PackedProgram) + PackedProgramArena::GetSizeClass(word_cnt) * PackedProgramArena::BLOCK_WORDS * sizeof(uint64_t);
+  }
+
+  /// Call fun(fID, tag, insts, len) for every function, in order.
+  template<typename FUN_T>
+  void ForEachFunction(FUN_T fun) const {
+    size_t pos = 0;
+    for (size_t fID = 0; fID < func_cnt; ++fID) {
+      const size_t len = GetFunctionLen(words[pos]);
+      fun(fID, GetTag(words[pos]), words + pos + 1, len);
+      pos += len + 1;
+    }
+  }
+
+  /// Does this program consist of exactly the given packed words?
+  bool Equals(const uint64_t * _words, size_t _word_cnt) const {
+    return word_cnt == _word_cnt && std::memcmp(words, _words, word_cnt * sizeof(uint64_t)) == 0;
+  }
+
+  bool operator==(const PackedProgram & other) const {
+    return func_cnt == other.func_cnt && Equals(other.words, other.word_cnt);
+  }
+};
+
+#endif
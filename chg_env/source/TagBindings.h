@@ -0,0 +1,55 @@
+#ifndef CHG_ENV_TAG_BINDINGS_H
+#define CHG_ENV_TAG_BINDINGS_H
+
+#include <cstdint>
+
+#include "base/vector.h"
+
+/// Precomputed matches between a fixed set of signal tags and the functions of a single program.
+///  - For every tag, stores every function tied for the best match at or above the similarity threshold
+///    (same rule as EventDrivenGP::FindBestFuncMatch), so ties can still be broken randomly at dispatch.
+///  - Only valid for the program (and similarity threshold) it was built for.
+class TagBindings {
+protected:
+  emp::vector<uint32_t> offsets;  ///< Matches for tag i are matches[offsets[i], offsets[i+1]).
+  emp::vector<uint32_t> matches;
+
+public:
+  TagBindings() : offsets(), matches() { ; }
+
+  void Clear() { offsets.clear(); matches.clear(); }
+
+  bool IsBuilt() const { return offsets.size() > 0; }
+  size_t GetTagCnt() const { return (offsets.size()) ? offsets.size() - 1 : 0; }
+
+  /// How many functions are tied for the best match to the given tag?
+  size_t GetMatchCnt(size_t tag_id) const { return offsets[tag_id + 1] - offsets[tag_id]; }
+
+  /// Functions tied for the best match to the given tag.
+  const uint32_t * GetMatches(size_t tag_id) const { return matches.data() + offsets[tag_id]; }
+
+  /// Build bindings for tag_cnt tags against func_cnt functions.
+  ///  - match_fun(tag_id, func_id) must return the match score between a tag and a function.
+  template<typename MATCH_FUN_T>
+  void Build(size_t tag_cnt, size_t func_cnt, double threshold, MATCH_FUN_T match_fun) {
+    Clear();
+    offsets.emplace_back(0);
+    for (size_t tag_id = 0; tag_id < tag_cnt; ++tag_id) {
+      const size_t begin = matches.size();
+      double best = threshold;
+      for (size_t fID = 0; fID < func_cnt; ++fID) {
+        const double bind = match_fun(tag_id, fID);
+        if (bind == best) {
+          matches.emplace_back((uint32_t)fID);
+        } else if (bind > best) {
+          matches.resize(begin);
+          matches.emplace_back((uint32_t)fID);
+          best = bind;
+        }
+      }
+      offsets.emplace_back((uint32_t)matches.size());
+    }
+  }
+};
+
+#endif
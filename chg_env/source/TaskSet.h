@@ -6,7 +6,16 @@
 #include <algorithm>
 #include <functional>
 #include <map>
-#include <unordered_set>
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define CHG_ENV_TASKSET_SSE2 1
+#else
+#define CHG_ENV_TASKSET_SSE2 0
+#endif
 
 #include "base/Ptr.h"
 #include "base/vector.h"
@@ -21,6 +30,9 @@
 
 /// Task library for logic9 changing environment experiments.
 ///  - A library of tasks with common input/output types.
+///  - All task solutions live back-to-back in one flat, 16-byte aligned array that Submit scans
+///    (with SSE2 for 32-bit integer outputs).
+///  - Completions/credits are tracked with counters (no per-completion time stamps).
 template<typename INPUT_T, typename OUTPUT_T>
 class TaskSet {
 public:
@@ -35,21 +47,32 @@ public:
     size_t id;
     std::string desc;
     emp::vector<task_output_t> solutions;
-    emp::vector<size_t> completed_time_stamps;
-    emp::vector<size_t> credited_time_stamps;
+    size_t completed_cnt;
+    size_t credited_cnt;
     size_t wasted_completions; ///< Completions *before* receiving credit.
+    size_t fixed_sol_cnt;      ///< Number of solutions this task always has (0 if it varies).
     gen_sol_fun_t generate_solutions;
 
-    Task(const std::string & _n, size_t _i, gen_sol_fun_t _gen_sols, const std::string & _d)
-      : name(_n), id(_i), desc(_d), wasted_completions(0), generate_solutions(_gen_sols)
+    Task(const std::string & _n, size_t _i, gen_sol_fun_t _gen_sols, const std::string & _d, size_t _sol_cnt=0)
+      : name(_n), id(_i), desc(_d), completed_cnt(0), credited_cnt(0),
+        wasted_completions(0), fixed_sol_cnt(_sol_cnt), generate_solutions(_gen_sols)
     { ; }
 
-    size_t GetCompletionCnt() const { return completed_time_stamps.size(); }
-    size_t GetCreditedCnt() const { return credited_time_stamps.size(); }
+    size_t GetCompletionCnt() const { return completed_cnt; }
+    size_t GetCreditedCnt() const { return credited_cnt; }
     size_t GetWastedCompletionsCnt() const { return wasted_completions; }
   };
 
 protected:
+  /// Solutions per (16-byte) block of the flat solution array.
+  static constexpr size_t SOLUTION_BLOCK_SIZE = (sizeof(task_output_t) < 16) ? 16 / sizeof(task_output_t) : 1;
+  /// Can Submit compare against solutions with SSE2?
+  static constexpr bool SIMD_SCAN = CHG_ENV_TASKSET_SSE2 && std::is_integral<task_output_t>::value
+                                    && sizeof(task_output_t) == 4;
+
+  struct alignas(16) SolutionBlock {
+    std::array<task_output_t, SOLUTION_BLOCK_SIZE> vals;
+  };
 
   emp::vector<Task> task_lib;
   std::map<std::string, size_t> name_map;
@@ -65,7 +88,82 @@ protected:
   // task_input_t task_inputs;
 
   bool sollision;
-  std::unordered_set<task_output_t> solution_set; ///< Used for detecting collisions between solutions.
+
+  emp::vector<SolutionBlock> solution_blocks; ///< Every task's solutions, back-to-back (last block padded).
+  emp::vector<uint32_t> solution_task_ids;    ///< Task that each solution belongs to.
+  size_t solution_cnt;
+
+  task_output_t & GetSolutionSlot(size_t slot) {
+    return solution_blocks[slot / SOLUTION_BLOCK_SIZE].vals[slot % SOLUTION_BLOCK_SIZE];
+  }
+  const task_output_t & GetSolutionSlot(size_t slot) const {
+    return solution_blocks[slot / SOLUTION_BLOCK_SIZE].vals[slot % SOLUTION_BLOCK_SIZE];
+  }
+
+  /// Call fun(slot) for every solution slot equal to sol (in slot order).
+  template<typename FUN_T>
+  void ScanSolutions(const task_output_t & sol, FUN_T fun, std::false_type) const {
+    for (size_t slot = 0; slot < solution_cnt; ++slot) {
+      if (GetSolutionSlot(slot) == sol) fun(slot);
+    }
+  }
+
+#if CHG_ENV_TASKSET_SSE2
+  /// Call fun(slot) for every solution slot equal to sol (in slot order). Compares a whole block at a time.
+  template<typename FUN_T>
+  void ScanSolutions(const task_output_t & sol, FUN_T fun, std::true_type) const {
+    const __m128i key = _mm_set1_epi32((int)sol);
+    for (size_t blockID = 0; blockID < solution_blocks.size(); ++blockID) {
+      const __m128i vals = _mm_load_si128(reinterpret_cast<const __m128i *>(solution_blocks[blockID].vals.data()));
+      int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(vals, key)));
+      while (mask) {
+        const size_t slot = blockID * SOLUTION_BLOCK_SIZE + (size_t)__builtin_ctz((unsigned int)mask);
+        mask &= mask - 1;
+        if (slot < solution_cnt) fun(slot);
+      }
+    }
+  }
+#endif
+
+  /// Lay every task's (already generated) solutions out back-to-back and check for collisions.
+  ///  - Buffers keep their capacity across calls.
+  void LayoutSolutions() {
+    solution_cnt = 0;
+    for (size_t i = 0; i < task_lib.size(); ++i) solution_cnt += task_lib[i].solutions.size();
+    solution_blocks.resize((solution_cnt + SOLUTION_BLOCK_SIZE - 1) / SOLUTION_BLOCK_SIZE);
+    solution_task_ids.resize(solution_cnt);
+    size_t slot = 0;
+    for (size_t i = 0; i < task_lib.size(); ++i) {
+      for (size_t s = 0; s < task_lib[i].solutions.size(); ++s) {
+        GetSolutionSlot(slot) = task_lib[i].solutions[s];
+        solution_task_ids[slot] = (uint32_t)i;
+        ++slot;
+      }
+    }
+    // Any two solutions the same?
+    sollision = false;
+    for (size_t s0 = 0; s0 < solution_cnt; ++s0) {
+      for (size_t s1 = s0 + 1; s1 < solution_cnt; ++s1) {
+        sollision |= (GetSolutionSlot(s0) == GetSolutionSlot(s1));
+      }
+    }
+  }
+
+  /// Record a single completion of the given task.
+  void RecordCompletion(Task & task, bool credit) {
+    ++task.completed_cnt;
+    if (task.completed_cnt == 1) unique_tasks_completed++;
+    total_tasks_completed++;
+    if (credit) {
+      ++task.credited_cnt;
+      if (task.credited_cnt == 1) unique_tasks_credited++;
+      total_tasks_credited++;
+    } else if (!task.credited_cnt) {
+      // If you did it, but didn't get credit, increment wasted completions (total and task)
+      task.wasted_completions++;
+      total_tasks_wasted++;
+    }
+  }
 
 
 public:
@@ -79,7 +177,8 @@ public:
       time_all_tasks_completed(0),
       all_tasks_credited(false),
       all_tasks_completed(false),
-      sollision(false)
+      sollision(false),
+      solution_blocks(), solution_task_ids(), solution_cnt(0)
     { ; }
   ~TaskSet() { ; }
 
@@ -108,10 +207,11 @@ public:
 
   void AddTask(const std::string & name,
                const gen_sol_fun_t & gen_sols,
-               const std::string & desc = "")
+               const std::string & desc = "",
+               size_t sol_cnt = 0)
   {
     const size_t id = task_lib.size();
-    task_lib.emplace_back(name, id, gen_sols, desc);
+    task_lib.emplace_back(name, id, gen_sols, desc, sol_cnt);
     name_map[name] = id;
   }
 
@@ -127,9 +227,10 @@ public:
     all_tasks_credited = false;
     all_tasks_completed = false;
     for (size_t i = 0; i < task_lib.size(); ++i) {
-      task_lib[i].completed_time_stamps.resize(0);
-      task_lib[i].credited_time_stamps.resize(0);
-      task_lib[i].wasted_completions = 0;
+      Task & task = task_lib[i];
+      task.completed_cnt = 0;
+      task.credited_cnt = 0;
+      task.wasted_completions = 0;
     }
   }
 
@@ -138,20 +239,25 @@ public:
 
   /// Set inputs. Reset everything.
   void SetInputs(const task_input_t & inputs) {
-    sollision = false;
-    solution_set.clear();
     Reset();
     for (size_t i = 0; i < task_lib.size(); ++i) {
       task_lib[i].solutions.resize(0);
       task_lib[i].generate_solutions(task_lib[i], inputs);
-      for (size_t s = 0; s < task_lib[i].solutions.size(); ++s) {
-        if (emp::Has(solution_set, task_lib[i].solutions[s])) {
-          sollision = true;
-        } else {
-          solution_set.emplace(task_lib[i].solutions[s]);
-        }
-      }
     }
+    LayoutSolutions();
+  }
+
+  /// Set every task's solutions directly (skipping the solution generators). Reset everything.
+  ///  - Requires every task to have a fixed solution count; sols holds each task's solutions back-to-back, in task order.
+  void SetSolutions(const task_output_t * sols) {
+    Reset();
+    for (size_t i = 0; i < task_lib.size(); ++i) {
+      Task & task = task_lib[i];
+      emp_assert(task.fixed_sol_cnt, task.name);
+      task.solutions.assign(sols, sols + task.fixed_sol_cnt);
+      sols += task.fixed_sol_cnt;
+    }
+    LayoutSolutions();
   }
 
   /// Submit possible solution, checking against all tasks.
@@ -159,26 +265,10 @@ public:
   /// Return whether or not submitted solution was a solution.
   bool Submit(const task_output_t & sol, size_t timestamp=0, bool credit=true) {
     bool success = false;
-    for (size_t i = 0; i < task_lib.size(); ++i) {
-      Task & task = task_lib[i];
-      for (size_t s = 0; s < task.solutions.size(); ++s) {
-        if (task.solutions[s] == sol) {
-          success = true;
-          task.completed_time_stamps.emplace_back(timestamp);
-          if (task.GetCompletionCnt() == 1) unique_tasks_completed++;
-          total_tasks_completed++;
-          if (credit) {
-            task.credited_time_stamps.emplace_back(timestamp);
-            if (task.GetCreditedCnt() == 1) unique_tasks_credited++;
-            total_tasks_credited++;
-          } else if (!task.GetCreditedCnt()) {
-            // If you did it, but didn't get credit, increment wasted completions (total and task)
-            task.wasted_completions++;
-            total_tasks_wasted++;
-          }
-        }
-      }
-    }
+    ScanSolutions(sol, [this, &success, credit](size_t slot) {
+      success = true;
+      this->RecordCompletion(task_lib[solution_task_ids[slot]], credit);
+    }, std::integral_constant<bool, SIMD_SCAN>());
     if (!all_tasks_credited && unique_tasks_credited == GetSize()) {
       time_all_tasks_credited = timestamp;
       all_tasks_credited = true;
@@ -16,6 +16,13 @@ EMP_BUILD_CONFIG( L9ChgEnvConfig,
   VALUE(TRIAL_CNT, size_t, 3, "..."),
   VALUE(TASKS_ON, bool, true, "Run with or without tasks?"),
   VALUE(EVOLVE_SIMILARITY_THRESH, bool, false, "Are we evolving the min required similarity threshold?"),
+  VALUE(EVAL_THREADS, size_t, 1, "How many threads should we use to evaluate the population? (each thread gets its own evaluation hardware, tasks, environment, and random number generator; EMP_TRACK_MEM builds, e.g. make debug, run the threads' work serially)"),
+  VALUE(EVAL_RNG_MODE, size_t, 0, "Where do evaluations get random numbers from?\n0: One shared stream (results depend on evaluation order)\n1: Independent stream per trial, keyed by (RANDOM_SEED, update, agent, trial)"),
+  VALUE(EVAL_BATCH_SIZE, size_t, 0, "How many agents should each evaluation thread advance in lockstep? (0 or 1: one agent at a time, on EventDrivenGP hardware unless EVAL_FLAT_HARDWARE; >1 requires ENVIRONMENT_COMMON_SCHEDULES)"),
+  VALUE(EVAL_DEDUPLICATE, bool, false, "Evaluate each distinct genome only once per update? (identical genomes share the phenotypes of the first one)"),
+  VALUE(EVAL_IDLE_FAST_FORWARD, bool, false, "Skip ahead to the next environment event whenever an agent's hardware is idle (no active cores or queued events)? (requires ENVIRONMENT_COMMON_SCHEDULES)"),
+  VALUE(EVAL_SIGNAL_HOOKS, bool, false, "Advance trials through do_env_advance_sig/do_agent_advance_sig every timestep? (slower; only needed for instrumentation hooks)"),
+  VALUE(EVAL_FLAT_HARDWARE, bool, false, "Evaluate agents on lockstep hardware (flat, fixed-size register files) even if EVAL_BATCH_SIZE is 0 or 1? (requires ENVIRONMENT_COMMON_SCHEDULES; programs with arguments outside the register files fall back to EventDrivenGP hardware)"),
   GROUP(ENVIRONMENT_GROUP, "Environment Settings"),
   VALUE(ENVIRONMENT_STATES, size_t, 8, "Total possible number of environment states"),
   VALUE(ENVIRONMENT_TAG_GENERATION_METHOD, size_t, 0, "How should we generate environment tags?\n0: Randomly\n1: Load from file"),
@@ -26,16 +33,19 @@ EMP_BUILD_CONFIG( L9ChgEnvConfig,
   VALUE(ENVIRONMENT_DISTRACTION_SIGNALS, bool, false, "Turn on distractions?"),
   VALUE(ENVIRONMENT_DISTRACTION_SIGNAL_CNT, size_t, 8, "How many distraction signals?"),
   VALUE(ENVIRONMENT_DISTRACTION_SIGNAL_PROB, double, 0.125, "Probability of environment emitting a distraction signal"),
+  VALUE(ENVIRONMENT_COMMON_SCHEDULES, bool, false, "Generate TRIAL_CNT environment schedules (changes, distraction signals, task inputs) once per update and replay them for every agent?"),
   GROUP(SELECTION_GROUP, "Selection Settings"),
   VALUE(TOURNAMENT_SIZE, size_t, 4, "How big are tournaments when using tournament selection or any selection method that uses tournaments?"),
   VALUE(SELECTION_METHOD, size_t, 0, "Which selection method are we using? \n0: Tournament\n1: Lexicase\n2: Eco-EA (resource)\n3: MAP-Elites\n4: Roulette"),
   VALUE(ELITE_SELECT__ELITE_CNT, size_t, 1, "How many elites get free reproduction passes?"),
+  VALUE(REPRODUCTION_THREADS, size_t, 0, "How many threads should build the next generation? (0: serial selection and mutation through the world; >0: parallel tournaments and mutation with random number streams keyed by (RANDOM_SEED, update, offspring chunk), so results don't depend on the thread count; tournament selection only; serial in EMP_TRACK_MEM builds)"),
   VALUE(MAP_ELITES_AXIS__INST_ENTROPY, bool, true, "Should MAP-Elites use instruction entropy as an axis?"),
   VALUE(MAP_ELITES_AXIS__FUNCTIONS_USED, bool, true, "Should MAP-Elites use functions used as an axis?"),
   VALUE(MAP_ELITES_AXIS__FUNCTION_CNT, bool, true, "Should MAP-Elites use an agent's function count as an axis?"),
   VALUE(MAP_ELITES_AXIS__SIMILARITY_THRESH, bool, false, "Should MAP-Elites use similarity thresholds as an axis?"),
   VALUE(MAP_ELITES_AXIS_RES__INST_ENTROPY, size_t, 25, "Resolution of entropy axis in map elites (number of bins)"),
   VALUE(MAP_ELITES_AXIS_RES__SIMILARITY_THRESH, size_t, 20, "Resolution of similarity threshold in map elites (number of bins)"),
+  VALUE(MAP_ELITES_BATCH_SIZE, size_t, 0, "How many MAP-Elites offspring should be bred from the same archive and evaluated in parallel (EVAL_THREADS)? (0: one at a time, through the world, on a dense grid, as emp::SetMapElites; >0: sparse archive that only stores occupied cells; unlike emp::SetMapElites, every offspring in a batch is bred from the archive as it was at the start of the batch, and an offspring that lands on a cell taken earlier in the same batch is compared against that elite's fresh score without re-evaluating it)"),
   GROUP(SGP_PROGRAM_GROUP, "SignalGP program Settings"),
   VALUE(SGP_PROG_MAX_FUNC_CNT, size_t, 8, "Used for generating SGP programs. How many functions do we generate?"),
   VALUE(SGP_PROG_MIN_FUNC_CNT, size_t, 1, "Used for generating SGP programs. How many functions do we generate?"),
@@ -59,6 +69,7 @@ EMP_BUILD_CONFIG( L9ChgEnvConfig,
   VALUE(SGP_MUT_PER_FUNC__SLIP_RATE, double, 0.05, "Per-function rate of slip mutations."),
   VALUE(SGP_MUT_PER_FUNC__FUNC_DUP_RATE, double, 0.05, "Per-function rate of function duplications."),
   VALUE(SGP_MUT_PER_FUNC__FUNC_DEL_RATE, double, 0.05, "Per-function rate of function deletions."),
+  VALUE(SGP_MUT_SAMPLING_MODE, size_t, 0, "How are mutation sites sampled?\n0: Per site (one random draw per tag bit, instruction, argument, and function)\n1: Geometric skip (jump straight to mutated sites; same mutation distribution, different random number stream)"),
   GROUP(DATA_GROUP, "Data Collection Settings"),
   VALUE(SYSTEMATICS_INTERVAL, size_t, 100, "Interval to record systematics summary stats."),
   VALUE(FITNESS_INTERVAL, size_t, 100, "Interval to record fitness summary stats."),
@@ -66,7 +77,7 @@ EMP_BUILD_CONFIG( L9ChgEnvConfig,
   VALUE(DOM_SNAPSHOT_TRIAL_CNT, size_t, 100, "How many times should we evaluate dominant agent?"),
   VALUE(DATA_DIRECTORY, std::string, "./", "Location to dump data output."),
   GROUP(ANALYSIS_GROUP, "Analysis Settings"),
-  VALUE(ANALYSIS_METHOD, size_t, 0, "..."),
+  VALUE(ANALYSIS_METHOD, size_t, 0, "Which analysis should we run?\n0: Evaluation engine benchmark (EventDrivenGP vs. lockstep hardware)\n1: Per-instruction dispatch benchmark (EventDrivenGP vs. lockstep hardware)\n2: Lockstep equivalence (EventDrivenGP vs. lockstep vs. fused lockstep programs)\n3: Hardware trajectory check (evolution on EventDrivenGP vs. lockstep hardware)"),
   VALUE(ANALYZE_AGENT_FPATH, std::string, "ancestor.gp", "Path to single agent program to analzye."),
   VALUE(ANALYSIS_OUTPUT_FNAME, std::string, "analysis.csv", "...")
 )
@@ -8,6 +8,23 @@
 #include "../l9_chg_env-config.h"
 #include "../Experiment.h"
 
+#ifdef CHG_ENV_COUNT_ALLOCS
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Count heap allocations (reported by the evaluation benchmark; build with `make bench`).
+static std::atomic<size_t> heap_alloc_cnt(0);
+
+void * operator new(size_t size) {
+  heap_alloc_cnt.fetch_add(1, std::memory_order_relaxed);
+  if (void * ptr = std::malloc((size) ? size : 1)) return ptr;
+  throw std::bad_alloc();
+}
+void operator delete(void * ptr) noexcept { std::free(ptr); }
+void operator delete(void * ptr, size_t) noexcept { std::free(ptr); }
+#endif
+
 int main(int argc, char* argv[])
 {
   // Read configs.
@@ -29,5 +46,8 @@ int main(int argc, char* argv[])
             << std::endl;
 
   Experiment e(config);
+#ifdef CHG_ENV_COUNT_ALLOCS
+  e.SetHeapAllocCounter([]() { return heap_alloc_cnt.load(std::memory_order_relaxed); });
+#endif
   e.Run();
 }